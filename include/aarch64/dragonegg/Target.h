@@ -0,0 +1,111 @@
+//==----- Target.h - Target hooks for GCC to LLVM conversion -----*- C++ -*-==//
+//
+// Copyright (C) 2013  Duncan Sands et al.
+//
+// This file is part of DragonEgg.
+//
+// DragonEgg is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2, or (at your option) any later version.
+//
+// DragonEgg is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// DragonEgg; see the file COPYING.  If not, write to the Free Software
+// Foundation, 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+//
+//===----------------------------------------------------------------------===//
+// This file declares some target-specific hooks for GCC to LLVM conversion.
+// It implements the AArch64 procedure call standard (AAPCS64).
+//===----------------------------------------------------------------------===//
+
+#ifndef DRAGONEGG_TARGET_H
+#define DRAGONEGG_TARGET_H
+
+namespace llvm { class SubtargetFeatures; }
+
+#ifdef DRAGONEGG_ABI_H
+
+struct DefaultABIClient;
+
+/* Composite types larger than 16 bytes that are not homogeneous floating point
+   aggregates are replaced by a pointer to a caller allocated copy.  */
+extern bool llvm_aarch64_try_pass_aggregate_custom(
+    tree_node *, std::vector<Type *> &, CallingConv::ID CC,
+    struct DefaultABIClient *);
+
+#define LLVM_TRY_PASS_AGGREGATE_CUSTOM(T, E, CC, C)                            \
+  llvm_aarch64_try_pass_aggregate_custom((T), (E), (CC), (C))
+
+extern bool llvm_aarch64_should_pass_aggregate_in_mixed_regs(
+    tree_node *, Type *Ty, CallingConv::ID, std::vector<Type *> &);
+
+/* Homogeneous floating point and short vector aggregates are passed in SIMD
+   registers, other small composites in general purpose registers.  */
+#define LLVM_SHOULD_PASS_AGGREGATE_IN_MIXED_REGS(T, TY, CC, E)                 \
+  llvm_aarch64_should_pass_aggregate_in_mixed_regs((T), (TY), (CC), (E))
+
+extern bool llvm_aarch64_aggregate_partially_passed_in_regs(
+    std::vector<Type *> &, std::vector<Type *> &, CallingConv::ID CC);
+
+/* AAPCS64 never splits a composite between registers and the stack.  */
+#define LLVM_AGGREGATE_PARTIALLY_PASSED_IN_REGS(E, SE, ISR, CC)                \
+  llvm_aarch64_aggregate_partially_passed_in_regs((E), (SE), (CC))
+
+extern void llvm_aarch64_spilled_aggregate_padding(
+    std::vector<Type *> &, std::vector<Type *> &, CallingConv::ID CC,
+    std::vector<Type *> &);
+
+/* Once a composite is passed on the stack, no later argument may use the
+   remaining registers of the class it would have gone in (rules C.3, C.11).  */
+#define LLVM_SPILLED_AGGREGATE_PADDING(E, SE, CC, P)                           \
+  llvm_aarch64_spilled_aggregate_padding((E), (SE), (CC), (P))
+
+extern Type *
+llvm_aarch64_aggr_type_for_struct_return(tree_node *type, CallingConv::ID CC);
+
+/* LLVM_AGGR_TYPE_FOR_STRUCT_RETURN - Return LLVM Type if X can be
+  returned as an aggregate, otherwise return NULL. */
+#define LLVM_AGGR_TYPE_FOR_STRUCT_RETURN(X, CC)                                \
+  llvm_aarch64_aggr_type_for_struct_return((X), (CC))
+
+extern void llvm_aarch64_extract_multiple_return_value(
+    Value *Src, Value *Dest, bool isVolatile, LLVMBuilder &B);
+
+/* LLVM_EXTRACT_MULTIPLE_RETURN_VALUE - Extract multiple return value from
+  SRC and assign it to DEST. */
+#define LLVM_EXTRACT_MULTIPLE_RETURN_VALUE(Src, Dest, V, B)                    \
+  llvm_aarch64_extract_multiple_return_value((Src), (Dest), (V), (B))
+
+extern bool llvm_aarch64_should_return_aggregate_in_regs(tree_node *TreeType,
+                                                         CallingConv::ID CC);
+
+/* LLVM_SHOULD_NOT_USE_SHADOW_RETURN = Return true is the given type should
+  not be returned via a shadow parameter with the given calling conventions. */
+#define LLVM_SHOULD_NOT_USE_SHADOW_RETURN(X, CC)                               \
+  llvm_aarch64_should_return_aggregate_in_regs((X), (CC))
+
+/* Vectors bigger than 128 are returned using sret.  */
+#define LLVM_SHOULD_RETURN_VECTOR_AS_SHADOW(X, isBuiltin)                      \
+  (TREE_INT_CST_LOW(TYPE_SIZE(X)) > 128)
+
+#endif /* DRAGONEGG_ABI_H */
+
+#define LLVM_TARGET_INTRINSIC_PREFIX "aarch64"
+
+/* LLVM_TARGET_NAME - This specifies the name of the target, which correlates to
+ * the llvm::InitializeXXXTarget() function.
+ */
+#define LLVM_TARGET_NAME AArch64
+
+/* Turn -mcpu=xx and the +feature modifiers of -march/-mcpu into a CPU type
+ * and LLVM subtarget features.
+ */
+extern void llvm_aarch64_set_subtarget_features(std::string &C,
+                                                llvm::SubtargetFeatures &F);
+#define LLVM_SET_SUBTARGET_FEATURES(C, F)                                      \
+  llvm_aarch64_set_subtarget_features(C, F)
+
+#endif /* DRAGONEGG_TARGET_H */
@@ -322,12 +322,9 @@ extern bool llvm_arm_should_pass_or_return_aggregate_in_regs(
    invocation into normal LLVM code.  If the target can handle the builtin, this
    macro should call the target TreeToLLVM::TargetIntrinsicLower method and
    return true.  This macro is invoked from a method in the TreeToLLVM class. */
-#if 0
-// Because of data dependency, we will implement later on.
-#define LLVM_TARGET_INTRINSIC_LOWER(EXP, BUILTIN_CODE, DESTLOC, RESULT,        \
-                                    DESTTY, OPS)                               \
-  TargetIntrinsicLower(EXP, BUILTIN_CODE, DESTLOC, RESULT, DESTTY, OPS);
-#endif
+#define LLVM_TARGET_INTRINSIC_LOWER(STMT, FNDECL, DESTLOC, RESULT, DESTTY,     \
+                                    OPS)                                       \
+  TargetIntrinsicLower(STMT, FNDECL, DESTLOC, RESULT, DESTTY, OPS);
 
 /* LLVM_GET_REG_NAME - The registers known to llvm as "r10", "r11", and "r12"
    may have different names in GCC.  Register "r12" is called "ip", and on
@@ -345,8 +342,4 @@ extern bool llvm_arm_should_pass_or_return_aggregate_in_regs(
                                              ? REG_NAME                        \
                                              : reg_names[REG_NUM])
 
-/* Define a static enumeration of the NEON builtins to be used when
-   converting to LLVM intrinsics.  These names are derived from the
-   neon_builtin_data table in arm.c and should be kept in sync with that.  */
-
 #endif /* DRAGONEGG_TARGET_H */
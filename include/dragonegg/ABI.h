@@ -31,6 +31,7 @@
 #include "dragonegg/TypeConversion.h"
 
 // LLVM headers
+#include "llvm/IR/Attributes.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/LLVMContext.h"
 
@@ -103,6 +104,147 @@ struct DefaultABIClient {
   virtual void HandlePad(llvm::Type */*LLVMTy*/) {}
 };
 
+/// ABIPlan - The sequence of client callbacks made by DefaultABI when lowering
+/// the result and arguments of a call.  Replaying a plan on a client has the
+/// same effect as redoing the lowering, without repeating the target specific
+/// classification of the argument types.
+struct ABIPlan {
+  struct Step {
+    enum StepKind {
+      ScalarResult,
+      AggregateResultAsScalar,
+      AggregateResultAsAggregate,
+      AggregateShadowResult,
+      ScalarShadowResult,
+      ScalarArgument,
+      ByInvisibleReferenceArgument,
+      ByValArgument,
+      FCAArgument,
+      EnterField,
+      ExitField,
+      Pad
+    } Kind;
+    llvm::Type *Ty;
+    tree_node *type;
+    unsigned Num; // Offset, RealSize or FieldNo, depending on Kind.
+    bool RetPtr;
+  };
+
+  /// ResultType, ArgTypes - The GCC types the plan was computed for.
+  tree_node *ResultType;
+  std::vector<tree_node *> ArgTypes;
+  llvm::CallingConv::ID CallingConv;
+
+  /// ResultSteps, ArgSteps - The callbacks made for the result and for each
+  /// argument, along with the attributes computed for each argument.
+  std::vector<Step> ResultSteps;
+  std::vector<std::vector<Step> > ArgSteps;
+  std::vector<llvm::AttrBuilder> ArgAttrs;
+
+  ABIPlan() : ResultType(0), CallingConv(llvm::CallingConv::C) {}
+
+  /// Replay - Invoke the recorded callbacks on the given client.
+  static void Replay(const std::vector<Step> &Steps, DefaultABIClient &C);
+};
+
+/// ABIPlanRecorder - An ABI client that records the callbacks it receives in a
+/// plan before passing them on to another client.
+class ABIPlanRecorder : public DefaultABIClient {
+  DefaultABIClient &C;
+  std::vector<ABIPlan::Step> *Steps;
+
+  void Record(ABIPlan::Step::StepKind Kind, llvm::Type *Ty = 0,
+              tree_node *type = 0, unsigned Num = 0, bool RetPtr = false) {
+    ABIPlan::Step S = { Kind, Ty, type, Num, RetPtr };
+    Steps->push_back(S);
+  }
+
+public:
+  ABIPlan &Plan;
+
+  ABIPlanRecorder(DefaultABIClient &c, ABIPlan &P)
+      : C(c), Steps(&P.ResultSteps), Plan(P) {}
+
+  /// BeginArgument - Start recording the callbacks for a new argument.
+  void BeginArgument(tree_node *type) {
+    Plan.ArgTypes.push_back(type);
+    Plan.ArgSteps.push_back(std::vector<ABIPlan::Step>());
+    Steps = &Plan.ArgSteps.back();
+  }
+
+  /// EndArgument - Record the attributes computed for the current argument.
+  void EndArgument(const llvm::AttrBuilder &Attrs) {
+    Plan.ArgAttrs.push_back(Attrs);
+  }
+
+  llvm::CallingConv::ID getCallingConv(void) { return C.getCallingConv(); }
+  bool isShadowReturn() const { return C.isShadowReturn(); }
+
+  void HandleScalarResult(llvm::Type *RetTy) {
+    Record(ABIPlan::Step::ScalarResult, RetTy);
+    C.HandleScalarResult(RetTy);
+  }
+  void HandleAggregateResultAsScalar(llvm::Type *ScalarTy,
+                                     unsigned Offset = 0) {
+    Record(ABIPlan::Step::AggregateResultAsScalar, ScalarTy, 0, Offset);
+    C.HandleAggregateResultAsScalar(ScalarTy, Offset);
+  }
+  void HandleAggregateResultAsAggregate(llvm::Type *AggrTy) {
+    Record(ABIPlan::Step::AggregateResultAsAggregate, AggrTy);
+    C.HandleAggregateResultAsAggregate(AggrTy);
+  }
+  void HandleAggregateShadowResult(llvm::PointerType *PtrArgTy, bool RetPtr) {
+    Record(ABIPlan::Step::AggregateShadowResult, PtrArgTy, 0, 0, RetPtr);
+    C.HandleAggregateShadowResult(PtrArgTy, RetPtr);
+  }
+  void HandleScalarShadowResult(llvm::PointerType *PtrArgTy, bool RetPtr) {
+    Record(ABIPlan::Step::ScalarShadowResult, PtrArgTy, 0, 0, RetPtr);
+    C.HandleScalarShadowResult(PtrArgTy, RetPtr);
+  }
+  void HandleScalarArgument(llvm::Type *LLVMTy, tree_node *type,
+                            unsigned RealSize = 0) {
+    Record(ABIPlan::Step::ScalarArgument, LLVMTy, type, RealSize);
+    C.HandleScalarArgument(LLVMTy, type, RealSize);
+  }
+  void HandleByInvisibleReferenceArgument(llvm::Type *PtrTy, tree_node *type) {
+    Record(ABIPlan::Step::ByInvisibleReferenceArgument, PtrTy, type);
+    C.HandleByInvisibleReferenceArgument(PtrTy, type);
+  }
+  void HandleByValArgument(llvm::Type *LLVMTy, tree_node *type) {
+    Record(ABIPlan::Step::ByValArgument, LLVMTy, type);
+    C.HandleByValArgument(LLVMTy, type);
+  }
+  void HandleFCAArgument(llvm::Type *LLVMTy, tree_node *type) {
+    Record(ABIPlan::Step::FCAArgument, LLVMTy, type);
+    C.HandleFCAArgument(LLVMTy, type);
+  }
+  void EnterField(unsigned FieldNo, llvm::Type *StructTy) {
+    Record(ABIPlan::Step::EnterField, StructTy, 0, FieldNo);
+    C.EnterField(FieldNo, StructTy);
+  }
+  void ExitField() {
+    Record(ABIPlan::Step::ExitField);
+    C.ExitField();
+  }
+  void HandlePad(llvm::Type *LLVMTy) {
+    Record(ABIPlan::Step::Pad, LLVMTy);
+    C.HandlePad(LLVMTy);
+  }
+};
+
+/// getCachedABIPlan - Return the plan recorded for calls to Fn (a function
+/// declaration, or the function type for indirect calls) with function type
+/// FnType, or null if there is none.  The caller must check that the plan was
+/// computed for the argument types at hand.
+extern ABIPlan *getCachedABIPlan(tree_node *Fn, tree_node *FnType);
+
+/// setCachedABIPlan - Remember the plan for calls to Fn with type FnType.
+extern void setCachedABIPlan(tree_node *Fn, tree_node *FnType,
+                             const ABIPlan &Plan);
+
+/// clearABIPlanCache - Forget all recorded plans.
+extern void clearABIPlanCache();
+
 // LLVM_SHOULD_NOT_RETURN_COMPLEX_IN_MEMORY - A hook to allow
 // special _Complex handling. Return true if X should be returned using
 // multiple value return instruction.
@@ -214,6 +356,15 @@ inline llvm::Type *getLLVMAggregateTypeForStructReturn(tree_node */*type*/) {
 #define LLVM_AGGREGATE_PARTIALLY_PASSED_IN_REGS(E, SE, ISR, CC) false
 #endif
 
+// LLVM_SPILLED_AGGREGATE_PADDING - Only called if
+// LLVM_AGGREGATE_PARTIALLY_PASSED_IN_REGS returns true, in which case the
+// aggregate is passed in memory.  Adds to P the types of any argument passing
+// registers that may no longer be used as a result.  These are passed as
+// padding arguments.
+#ifndef LLVM_SPILLED_AGGREGATE_PADDING
+#define LLVM_SPILLED_AGGREGATE_PADDING(E, SE, CC, P)
+#endif
+
 // LLVM_BYVAL_ALIGNMENT - Returns the alignment of the type in bytes, if known,
 // in the getGlobalContext() of its use as a function parameter.
 // Note that the alignment in the TYPE node is usually the alignment appropriate
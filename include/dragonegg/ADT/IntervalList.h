@@ -17,7 +17,7 @@
 // Foundation, 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
 //
 //===----------------------------------------------------------------------===//
-// This file declares a utility class for maintaining a collection of pairwise
+// This file declares utility classes for maintaining a collection of pairwise
 // disjoint intervals.
 //===----------------------------------------------------------------------===//
 
@@ -30,6 +30,11 @@
 // LLVM headers
 #include "llvm/ADT/SmallVector.h"
 
+// System headers
+#include <algorithm>
+#include <map>
+#include <utility>
+
 /// IntervalList - Maintains a list of disjoint intervals.  Type 'T' represents
 /// an interval, and should have a getRange method which returns a range of 'U'
 /// values.  In addition it should provide ChangeRangeTo for growing, shrinking
@@ -53,6 +58,20 @@ template <class T, typename U, unsigned N> class IntervalList {
     return L.getRange().getLast() < R.getRange().getLast();
   }
 
+  /// Numbered - An interval together with its precedence when resolving
+  /// overlaps: where intervals overlap, the one with the higher number wins.
+  typedef std::pair<T, unsigned> Numbered;
+
+  /// CmpNumberedFirst - Compare numbered intervals based on where they start.
+  static bool CmpNumberedFirst(const Numbered &L, const Numbered &R) {
+    return CmpFirst(L.first, R.first);
+  }
+
+  /// CmpPrecedence - Compare numbered intervals based on their precedence.
+  static bool CmpPrecedence(const Numbered &L, const Numbered &R) {
+    return L.second < R.second;
+  }
+
   /// isSane - Return true if the intervals are non-empty, disjoint and
   /// sorted.
   bool isSane() const {
@@ -76,6 +95,14 @@ public:
   /// interval is empty then it will be discarded.
   void AddInterval(const T &S);
 
+  /// AddIntervals - Add the intervals in [Begin, End) to the list.  The result
+  /// is the same as adding them one by one using AddInterval, so where they
+  /// overlap later intervals take precedence over earlier ones.  However this
+  /// sorts the intervals once and only resolves overlaps between intervals that
+  /// actually overlap, rather than shuffling the list around for every interval
+  /// added, making it O(n log n) rather than O(n^2) when there are few overlaps.
+  template <class InputIt> void AddIntervals(InputIt Begin, InputIt End);
+
   /// getNumIntervals - Return the number of intervals in the list.
   unsigned getNumIntervals() const { return (unsigned) Intervals.size(); }
 
@@ -156,6 +183,61 @@ void IntervalList<T, U, N>::AddInterval(const T &Interval) {
   assert(isSane() && "Interval added wrong!");
 }
 
+/// AddIntervals - Add the intervals in [Begin, End) to the list.  The result
+/// is the same as adding them one by one using AddInterval, so where they
+/// overlap later intervals take precedence over earlier ones.
+template <class T, typename U, unsigned N>
+template <class InputIt>
+void IntervalList<T, U, N>::AddIntervals(InputIt Begin, InputIt End) {
+  // Number the intervals by precedence.  The existing intervals come first, and
+  // as they are disjoint they can all have the same number.
+  llvm::SmallVector<Numbered, N> All;
+  for (iterator I = Intervals.begin(), E = Intervals.end(); I != E; ++I)
+    All.push_back(Numbered(*I, 0));
+  unsigned NumAdded = 0;
+  for (; Begin != End; ++Begin)
+    // Empty intervals are discarded, like in AddInterval.
+    if (!Begin->getRange().empty())
+      All.push_back(Numbered(*Begin, ++NumAdded));
+  if (!NumAdded)
+    return;
+
+  // Sort by starting point.  Fields usually arrive in order (or in reverse
+  // order), so it is worth checking whether there is anything to do.
+  bool Sorted = true;
+  for (unsigned i = 1, e = (unsigned) All.size(); i < e && Sorted; ++i)
+    Sorted = !CmpNumberedFirst(All[i], All[i - 1]);
+  if (!Sorted)
+    std::stable_sort(All.begin(), All.end(), CmpNumberedFirst);
+
+  // Sweep through the intervals, grouping together those that overlap, directly
+  // or via other intervals.  An interval on its own is simply output.  A group
+  // of overlapping intervals is resolved by adding its members one by one in
+  // order of precedence.  Since groups do not overlap each other, this gives
+  // the same result as adding all the intervals one by one.
+  List Result;
+  for (unsigned i = 0, e = (unsigned) All.size(); i != e;) {
+    U GroupLast = All[i].first.getRange().getLast();
+    unsigned j = i + 1;
+    for (; j != e && All[j].first.getRange().getFirst() < GroupLast; ++j)
+      GroupLast = std::max(GroupLast, All[j].first.getRange().getLast());
+
+    if (j == i + 1) {
+      Result.push_back(All[i].first);
+    } else {
+      std::stable_sort(All.begin() + i, All.begin() + j, CmpPrecedence);
+      IntervalList Group;
+      for (unsigned k = i; k != j; ++k)
+        Group.AddInterval(All[k].first);
+      Result.append(Group.Intervals.begin(), Group.Intervals.end());
+    }
+    i = j;
+  }
+
+  Intervals.swap(Result);
+  assert(isSane() && "Intervals added wrong!");
+}
+
 /// AlignBoundaries - Ensure that all intervals begin and end on a multiple of
 /// the given value.
 template <class T, typename U, unsigned N>
@@ -212,4 +294,92 @@ void IntervalList<T, U, N>::AlignBoundaries(unsigned Alignment) {
   }
 }
 
+/// IntervalTree - Like IntervalList, maintains a collection of disjoint
+/// intervals, with the same requirements on the interval type 'T'.  The
+/// intervals are kept in a balanced tree keyed on where they start, so adding
+/// an interval costs O(log n) plus the number of intervals it displaces, where
+/// IntervalList may have to move every interval in the list.  Use this when
+/// intervals are added one at a time in no particular order and there can be
+/// a great many of them.
+template <class T, typename U> class IntervalTree {
+  typedef std::map<U, T> Tree;
+  typedef typename Tree::iterator iterator;
+
+  Tree Intervals;
+  // The actual intervals, indexed by where they start.  Always disjoint and
+  // non-empty.
+
+public:
+
+  /// AddInterval - Add the given interval.  If it overlaps any existing
+  /// intervals then the existing intervals are pruned by removing exactly the
+  /// parts of them that overlap the new interval.  If the added interval is
+  /// empty then it will be discarded.
+  void AddInterval(const T &Interval);
+
+  /// getNumIntervals - Return the number of intervals.
+  unsigned getNumIntervals() const { return (unsigned) Intervals.size(); }
+
+  /// getIntervals - Append the intervals to the given vector, sorted by where
+  /// they start.  The result can be passed to IntervalList::AddIntervals.
+  void getIntervals(llvm::SmallVectorImpl<T> &Out) const {
+    for (typename Tree::const_iterator I = Intervals.begin(),
+                                       E = Intervals.end();
+         I != E; ++I)
+      Out.push_back(I->second);
+  }
+};
+
+/// AddInterval - Add the given interval.  If it overlaps any existing intervals
+/// then the existing intervals are pruned by removing exactly the parts of them
+/// that overlap the new interval.  If the added interval is empty then it will
+/// be discarded.
+template <class T, typename U>
+void IntervalTree<T, U>::AddInterval(const T &Interval) {
+  const Range<U> NewRange = Interval.getRange();
+
+  // If the new interval is empty then there is no point in adding it.
+  if (NewRange.empty())
+    return;
+  const U First = NewRange.getFirst(), Last = NewRange.getLast();
+
+  // Check for overlap with the interval starting before the new one.
+  iterator I = Intervals.lower_bound(First);
+  if (I != Intervals.begin()) {
+    iterator Prev = I;
+    --Prev;
+    const Range<U> PrevRange = Prev->second.getRange();
+    if (First < PrevRange.getLast()) {
+      if (Last < PrevRange.getLast()) {
+        // The new interval is contained in Prev with an excedent at each end.
+        // Chop off the upper part and keep it as an interval of its own.
+        T UpperPart = Prev->second;
+        UpperPart.ChangeRangeTo(Range<U>(Last, PrevRange.getLast()));
+        Intervals.insert(I, std::make_pair(Last, UpperPart));
+      }
+      // Shrink the previous interval to remove the overlap.
+      Prev->second.ChangeRangeTo(Range<U>(PrevRange.getFirst(), First));
+    }
+  }
+
+  // Throw away intervals completely covered by the new interval.  The first one
+  // that sticks out past the end has the overlap removed.  Since that changes
+  // where it starts, it is reinserted.
+  while (I != Intervals.end() && I->first < Last) {
+    const Range<U> OldRange = I->second.getRange();
+    if (OldRange.getLast() <= Last) {
+      Intervals.erase(I++);
+      continue;
+    }
+    T UpperPart = I->second;
+    UpperPart.ChangeRangeTo(Range<U>(Last, OldRange.getLast()));
+    Intervals.erase(I++);
+    Intervals.insert(I, std::make_pair(Last, UpperPart));
+    break;
+  }
+
+  // The new interval is now disjoint from any existing intervals.  Insert it.
+  Intervals.insert(std::make_pair(First, Interval));
+}
+
 #endif /* DRAGONEGG_INTERVALLIST_H */
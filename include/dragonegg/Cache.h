@@ -20,7 +20,7 @@
 //===----------------------------------------------------------------------===//
 // This code lets you associate a value with a tree, as if it were cached inside
 // the tree: if the tree is garbage collected and reallocated, then the cached
-// value will have been cleared.
+// value will have been cleared.  Each kind of value has a table of its own.
 //===----------------------------------------------------------------------===//
 
 #ifndef DRAGONEGG_CACHE_H
@@ -33,6 +33,21 @@ class Value;
 }
 union tree_node;
 
+/// CacheKind - The side tables maintained by this module.
+enum CacheKind {
+  TypeCacheKind,   // GCC types to LLVM types.
+  IndexCacheKind,  // Field declarations to field indices.
+  ValueCacheKind,  // Initializers to the constants they were converted to.
+  GlobalCacheKind  // Declarations with RTL to LLVM global values.
+};
+
+/// CacheStatistics - Counters describing how well one of the tables is doing.
+struct CacheStatistics {
+  unsigned Hits;   // Lookups that found something.
+  unsigned Misses; // Lookups that came back empty.
+  unsigned Size;   // Number of entries currently in the table.
+};
+
 /// getCachedInteger - Returns true if there is an integer associated with the
 /// given GCC tree and puts the integer in 'val'.  Otherwise returns false.
 extern bool getCachedInteger(union tree_node *t, int &Val);
@@ -58,4 +73,21 @@ extern llvm::Value *getCachedValue(union tree_node *t);
 /// or the value deleted.
 extern void setCachedValue(union tree_node *t, llvm::Value *V);
 
+/// getCachedGlobal - Returns the global value associated with the given GCC
+/// declaration, or null if none.
+extern llvm::Value *getCachedGlobal(union tree_node *t);
+
+/// setCachedGlobal - Associates the given global value (which may be null) with
+/// the given GCC declaration.
+extern void setCachedGlobal(union tree_node *t, llvm::Value *V);
+
+/// sweepCaches - Forget everything cached for trees that the garbage collector
+/// did not mark.  Only valid while the collector's mark bits are, i.e. at the
+/// end of the marking phase.
+extern void sweepCaches();
+
+/// getCacheStatistics - Returns the hit, miss and size counters of the given
+/// table.
+extern CacheStatistics getCacheStatistics(CacheKind Kind);
+
 #endif /* DRAGONEGG_CACHE_H */
@@ -27,6 +27,7 @@
 #include "dragonegg/Internals.h"
 
 // LLVM headers
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/ValueHandle.h"
@@ -65,12 +66,20 @@ private:
   llvm::Function *DeclareFn; // llvm.dbg.declare
   llvm::Function *ValueFn;   // llvm.dbg.value
 
-  const char *CurFullPath;  // Previous location file encountered.
-  const char *PrevFullPath; // Previous location file encountered.
-  int CurLineNo;            // Previous location line# encountered.
+  bool LineTablesOnly;      // Only emit line tables (-g1).
+
+  unsigned CurLocation;     // Current GCC location_t.
+  unsigned CurFileID;       // Current location file, zero if none.
+  unsigned PrevFileID;      // Previous location file encountered.
+  int CurLineNo;            // Current location line#.
   int PrevLineNo;           // Previous location line# encountered.
   llvm::BasicBlock *PrevBB;       // Last basic block encountered.
 
+  /// FileIDs - Interned location file names.  FilePtrIDs caches the lookup by
+  /// the name's address, which is the same for most locations in a file.
+  llvm::StringMap<unsigned> FileIDs;
+  llvm::DenseMap<const char *, unsigned> FilePtrIDs;
+
 // Below line commented by Arun in attempt to compile using llvm 3.6
 //  std::map<tree_node *, llvm::WeakVH> TypeCache;
 // Below line added by Arun in attempt to compile using llvm 3.6
@@ -106,9 +115,13 @@ public:
   /// initialization is done.
   void Initialize();
 
-  // Accessors.
-  void setLocationFile(const char *FullPath) { CurFullPath = FullPath; }
-  void setLocationLine(int LineNo) { CurLineNo = LineNo; }
+  /// isLineTablesOnly - Return true if only line tables are being emitted, in
+  /// which case no type, variable or scope information is output.
+  bool isLineTablesOnly() const { return LineTablesOnly; }
+
+  /// setLocation - Set the current source location to the given GCC location_t
+  /// (UNKNOWN_LOCATION if none).
+  void setLocation(unsigned Loc);
 
   /// EmitFunctionStart - Constructs the debug code for entering a function -
   /// "llvm.dbg.func.start."
@@ -162,6 +175,10 @@ public:
   /// getOrCreateFile - Get DIFile descriptor.
   llvm::DIFile getOrCreateFile(const char *FullPath);
 
+  /// getFileID - Return a small non-zero number identifying the given file, or
+  /// zero if there is no file.
+  unsigned getFileID(const char *FullPath);
+
   /// findRegion - Find tree_node N's region.
   llvm::DIDescriptor findRegion(tree_node *n);
 
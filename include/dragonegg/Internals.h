@@ -33,6 +33,9 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormattedStream.h"
 
+// System headers
+#include <vector>
+
 struct basic_block_def;
 
 #if (GCC_MINOR <= 8) /* Condition added by Arun */
@@ -148,6 +151,19 @@ void register_ctor_dtor(llvm::Function *, int, bool);
 const char *extractRegisterName(tree_node *);
 void handleVisibility(tree_node *decl, llvm::GlobalValue *GV);
 
+/// isFunctionAddressTaken - Return whether the address of the given function
+/// is used for anything other than calling it.
+bool isFunctionAddressTaken(tree_node *decl);
+
+/// getVectorWidth - Return the size in octets of the widest vector register
+/// that the GCC vectorizer would use for the current target, or the size of a
+/// word if there are none.
+unsigned getVectorWidth();
+
+/// getDataAlignment - Return the alignment in bits to give the definition of
+/// the given variable, taking the target's data alignment policy into account.
+unsigned getDataAlignment(tree_node *decl);
+
 /// Return true if and only if field no. N from struct type T is a padding
 /// element added to match llvm struct type size and gcc struct type size.
 bool isPaddingElement(tree_node *, unsigned N);
@@ -249,8 +265,18 @@ class TreeToLLVM {
   // definitions.
   llvm::Instruction *SSAInsertionPoint;
 
-  /// BasicBlocks - Map from GCC to LLVM basic blocks.
-  llvm::DenseMap<basic_block_def *, llvm::BasicBlock *> BasicBlocks;
+  /// BasicBlocks - Map from GCC to LLVM basic blocks, indexed by the index of
+  /// the GCC basic block.  Null if no LLVM basic block was created yet.
+  std::vector<llvm::BasicBlock *> BasicBlocks;
+
+  /// BlockOwners - The GCC basic block that each LLVM basic block was output
+  /// for.  This includes the nameless blocks that continue a GCC basic block,
+  /// which are recorded by BeginBlock as they are created.
+  llvm::DenseMap<llvm::BasicBlock *, basic_block_def *> BlockOwners;
+
+  /// ContinuedBlock - The GCC basic block that nameless LLVM basic blocks begun
+  /// now continue, or null if there is none.
+  basic_block_def *ContinuedBlock;
 
   /// LocalDecls - Map from local declarations to their associated LLVM values.
   llvm::DenseMap<tree_node *, llvm::AssertingVH<llvm::Value> > LocalDecls;
@@ -258,8 +284,19 @@ class TreeToLLVM {
   /// PendingPhis - Phi nodes which have not yet been populated with operands.
   llvm::SmallVector<PhiRecord, 16> PendingPhis;
 
-  // SSANames - Map from GCC ssa names to the defining LLVM value.
-  llvm::DenseMap<tree_node *, llvm::TrackingVH<llvm::Value> > SSANames;
+  // SSANames - Map from GCC ssa names to the defining LLVM value, indexed by
+  // SSA_NAME_VERSION.  Like LocalDecls these are AssertingVH, which is a plain
+  // pointer in release builds, so whoever replaces a value must update the map.
+  std::vector<llvm::AssertingVH<llvm::Value> > SSANames;
+
+  // PlaceholderCopies - SSA names defined to be the placeholder of some other
+  // SSA name that was not yet defined.  Their SSANames entries are redirected
+  // when the placeholder is replaced.
+  llvm::SmallVector<tree_node *, 8> PlaceholderCopies;
+
+  // ClobberedLocals - Local variables for which an llvm.lifetime.end was output,
+  // possibly listed more than once.
+  llvm::SmallVector<llvm::AllocaInst *, 8> ClobberedLocals;
 
 public:
 
@@ -402,9 +439,21 @@ private : // Helper functions.
   /// PopulatePhiNodes - Populate generated phi nodes with their operands.
   void PopulatePhiNodes();
 
+  /// EmitLifetimeStarts - Output llvm.lifetime.start intrinsics for the local
+  /// variables that were clobbered.
+  void EmitLifetimeStarts();
+
   /// getBasicBlock - Find or create the LLVM basic block corresponding to BB.
   llvm::BasicBlock *getBasicBlock(basic_block_def *bb);
 
+  /// getBasicBlockSlot - Returns the entry of BasicBlocks for the given GCC
+  /// basic block, growing the table if need be.
+  llvm::BasicBlock *&getBasicBlockSlot(basic_block_def *bb);
+
+  /// getSSANameSlot - Returns the entry of SSANames for the given SSA name,
+  /// growing the table if need be.
+  llvm::AssertingVH<llvm::Value> &getSSANameSlot(tree_node *reg);
+
   /// getLabelDeclBlock - Lazily get and create a basic block for the specified
   /// label.
   llvm::BasicBlock *getLabelDeclBlock(tree_node *LabelDecl);
@@ -425,6 +474,15 @@ private : // Helper functions.
   /// DestLoc, zero'ing all of the elements.  Helper for EmitAggregateZero.
   void ZeroElementByElement(MemRef DestLoc, tree_node *type);
 
+  /// CopyByChunks - Copy Size octets from SrcLoc to DestLoc using accesses of
+  /// at most ChunkSize octets.
+  void CopyByChunks(MemRef DestLoc, MemRef SrcLoc, uint64_t Size,
+                    unsigned ChunkSize);
+
+  /// ZeroByChunks - Zero Size octets at DestLoc using stores of at most
+  /// ChunkSize octets.
+  void ZeroByChunks(MemRef DestLoc, uint64_t Size, unsigned ChunkSize);
+
   /// EmitAggregateZero - Zero the elements of DestLoc.
   void EmitAggregateZero(MemRef DestLoc, tree_node *type);
 
@@ -501,6 +559,14 @@ private:
   /// WriteScalarToLHS - Store RHS, a non-aggregate value, into the given LHS.
   void WriteScalarToLHS(tree_node *lhs, llvm::Value *Scalar);
 
+  /// EmitBitfieldStores - Output a run of stores to neighbouring bitfields of
+  /// the same object using a single read-modify-write.
+  void EmitBitfieldStores(llvm::ArrayRef<gimple_statement_d *> Stores);
+
+  /// getBitfieldAccessSize - Return the number of bits to load or store when
+  /// accessing the bitfield LV of the expression exp, adjusting LV if needed.
+  unsigned getBitfieldAccessSize(tree_node *exp, LValue &LV);
+
 private:
 
   //===---------- EmitReg* - Convert register expression to LLVM ----------===//
@@ -607,6 +673,7 @@ private:
   llvm::Value *EmitLoadOfLValue(tree_node *exp);
   llvm::Value *EmitOBJ_TYPE_REF(tree_node *exp);
   llvm::Value *EmitADDR_EXPR(tree_node *exp);
+  llvm::Value *EmitBIT_FIELD_REF(tree_node *exp);
 #if (GCC_MINOR < 7)
   llvm::Value *EmitCondExpr(tree_node *exp);
 #endif
@@ -773,6 +840,16 @@ private:
   /// elements of the given vector with indices in the bottom half.
   llvm::Value *VectorLowElements(llvm::Value *Vec);
 
+  /// VectorExtractLanes - Return the NumLanes elements of the given vector that
+  /// start at index FirstLane.  A single element is returned as a scalar.
+  llvm::Value *VectorExtractLanes(llvm::Value *Vec, unsigned FirstLane,
+                                  unsigned NumLanes);
+
+  /// VectorInsertLanes - Return the given vector with the elements starting at
+  /// index FirstLane replaced by Lanes, a scalar or a shorter vector.
+  llvm::Value *VectorInsertLanes(llvm::Value *Vec, llvm::Value *Lanes,
+                                 unsigned FirstLane);
+
 private:
   // Optional target defined builtin intrinsic expanding function.
   bool TargetIntrinsicLower(gimple_statement_d *stmt, tree_node *fndecl,
@@ -59,6 +59,13 @@ int GetFieldIndex(tree_node *decl, llvm::Type *Ty);
 /// i16.
 extern llvm::Type *GetUnitType(llvm::LLVMContext &C, unsigned NumUnits = 1);
 
+/// GetAggregatePrefix - If the given type is a struct or an array, return a
+/// packed struct type with alloc size the given number of bytes holding those
+/// leading elements of the type that fit, followed by bytes for the rest.  If
+/// no element fits then return null.
+extern llvm::StructType *GetAggregatePrefix(llvm::Type *Ty, uint64_t Bytes,
+                                            const llvm::DataLayout &DL);
+
 /// GetUnitPointerType - Returns an LLVM pointer type which points to memory one
 /// address unit wide.  For example, on a machine which has 16 bit bytes returns
 /// an i16*.
@@ -92,6 +99,11 @@ extern llvm::FunctionType *
 ConvertFunctionType(tree_node *type, tree_node *decl, tree_node *static_chain,
                     llvm::CallingConv::ID &CC, llvm::AttributeSet &PAL);
 
+/// InvalidateFunctionTypeCaches - Forget the memoized results of function type
+/// and call lowering.  Must be called whenever GCC garbage collects, since the
+/// caches are keyed on trees.
+extern void InvalidateFunctionTypeCaches();
+
 /// ConvertArgListToFnType - Given a DECL_ARGUMENTS list on an GCC tree,
 /// return the LLVM type corresponding to the function.  This is useful for
 /// turning "T foo(...)" functions into "T foo(void)" functions.
@@ -150,7 +150,8 @@ extern void llvm_x86_extract_multiple_return_value(
 
 extern bool llvm_x86_should_pass_vector_using_byval_attr(tree_node *);
 
-/* On x86-64, vectors which are not MMX nor SSE should be passed byval. */
+/* On x86-64, vectors which do not fit in an SSE, AVX or AVX-512 register
+   should be passed byval. */
 #define LLVM_SHOULD_PASS_VECTOR_USING_BYVAL_ATTR(X)                            \
   llvm_x86_should_pass_vector_using_byval_attr((X))
 
@@ -173,7 +174,8 @@ extern tree_node *llvm_x86_should_return_vector_as_scalar(tree_node *, bool);
 extern bool llvm_x86_should_return_vector_as_shadow(tree_node *, bool);
 
 /* MMX vectors v2i32, v4i16, v8i8, v2f32 are returned using sret on Darwin
-   32-bit.  Vectors bigger than 128 are returned using sret.  */
+   32-bit.  Vectors bigger than 128 are returned using sret unless AVX or
+   AVX-512 provides a register to hold them.  */
 #define LLVM_SHOULD_RETURN_VECTOR_AS_SHADOW(X, isBuiltin)                      \
   llvm_x86_should_return_vector_as_shadow((X), (isBuiltin))
 
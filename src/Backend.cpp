@@ -33,6 +33,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -84,6 +85,7 @@ extern "C" {
 #include "plugin-version.h"
 #endif
 #include "target.h" // For targetm.
+#include "tm_p.h"
 #include "toplev.h"
 //Below condition added by Arun in attempt to compile using gcc-4.9
 #if (GCC_MINOR <= 8)
@@ -172,6 +174,9 @@ static bool DebugPassStructure;
 static bool EnableGCCOptimizations;
 static bool EmitIR;
 static bool EmitObj;
+static bool MergeFunctions;
+static bool NoPLT;
+static bool NoSemanticInterposition;
 static bool SaveGCCOutput;
 static int LLVMCodeGenOptimizeArg = -1;
 static int LLVMIROptimizeArg = -1;
@@ -240,7 +245,7 @@ Value *set_decl_llvm(tree t, Value *V) {
   assert((isa<CONST_DECL>(t) || HAS_RTL_P(t)) &&
          "Expected a declaration with RTL!");
   assert((!V || isa<GlobalValue>(V)) && "Expected a global value!");
-  setCachedValue(t, V);
+  setCachedGlobal(t, V);
   return V;
 }
 
@@ -248,7 +253,7 @@ Value *set_decl_llvm(tree t, Value *V) {
 Value *get_decl_llvm(tree t) {
   assert((isa<CONST_DECL>(t) || HAS_RTL_P(t)) &&
          "Expected a declaration with RTL!");
-  Value *V = getCachedValue(t);
+  Value *V = getCachedGlobal(t);
   return V ? V->stripPointerCasts() : 0;
 }
 
@@ -297,6 +302,73 @@ void handleVisibility(tree decl, GlobalValue *GV) {
   }
 }
 
+/// isFunctionAddressTaken - Return whether the address of the given function
+/// is used for anything other than calling it.  If not, it is not significant
+/// and the function can be merged with an identical one.
+bool isFunctionAddressTaken(tree decl) {
+  if (!TREE_ADDRESSABLE(decl))
+    return false;
+  // Front-ends are conservative here, for example they may mark a function as
+  // addressable because of a use that was later optimized away.  The callgraph
+  // knows about the uses in the code that will actually be output.
+  if (struct cgraph_node *node = cgraph_get_node(decl))
+    return cgraph_symbol(node)->address_taken;
+  return true;
+}
+
+/// getVectorWidth - Return the size in octets of the widest vector register
+/// that the GCC vectorizer would use for the current target, or the size of a
+/// word if there are none.
+unsigned getVectorWidth() {
+  unsigned Width = UNITS_PER_WORD;
+#if (GCC_MINOR > 5)
+  if (unsigned VectorSizes = targetm.vectorize.autovectorize_vector_sizes())
+    Width = std::max(Width, 1U << Log2_32(VectorSizes));
+  else
+    Width = std::max(Width, (unsigned) GET_MODE_SIZE(
+                                targetm.vectorize.preferred_simd_mode(QImode)));
+#else
+  Width = std::max(Width, (unsigned) UNITS_PER_SIMD_WORD(QImode));
+#endif
+  return Width;
+}
+
+/// getDataAlignment - Return the alignment in bits to give the definition of
+/// the given variable.  When optimizing, the target's data alignment policy is
+/// applied like GCC does when outputting variables itself.  In addition arrays
+/// that are at least as big as a vector register are aligned to the vector
+/// width, so that vectorized loops over them need no peeling.  Local variables
+/// are not aligned beyond the preferred stack boundary, since that would need
+/// the stack to be realigned.
+unsigned getDataAlignment(tree decl) {
+  unsigned Align = DECL_ALIGN(decl);
+  if (DECL_USER_ALIGN(decl) || !optimize || optimize_size ||
+      (isa<VAR_DECL>(decl) && DECL_THREAD_LOCAL_P(decl)))
+    return Align;
+
+  tree type = TREE_TYPE(decl);
+  bool isLocal = !TREE_STATIC(decl) && !DECL_EXTERNAL(decl);
+  unsigned NewAlign = Align;
+  if (isLocal) {
+#ifdef LOCAL_ALIGNMENT
+    NewAlign = std::max(NewAlign, (unsigned) LOCAL_ALIGNMENT(type, Align));
+#endif
+  } else {
+#ifdef DATA_ALIGNMENT
+    NewAlign = std::max(NewAlign, (unsigned) DATA_ALIGNMENT(type, Align));
+#endif
+  }
+
+  unsigned VectorWidth = getVectorWidth();
+  if (isa<ARRAY_TYPE>(type) && isInt64(TYPE_SIZE_UNIT(type), true) &&
+      getInt64(TYPE_SIZE_UNIT(type), true) >= VectorWidth)
+    NewAlign = std::max(NewAlign, VectorWidth * 8);
+
+  unsigned MaxAlign = isLocal ? (unsigned) PREFERRED_STACK_BOUNDARY
+                              : (unsigned) MAX_OFILE_ALIGNMENT;
+  return std::max(Align, std::min(NewAlign, MaxAlign));
+}
+
 /// CodeGenOptLevel - The optimization level to be used by the code generators.
 static CodeGenOpt::Level CodeGenOptLevel() {
   int OptLevel =
@@ -816,11 +888,19 @@ static void createPerModuleOptimizationPasses() {
   PassBuilder.Inliner = InliningPass;
   PassBuilder.populateModulePassManager(*PerModulePasses);
 
+  // Fold functions with identical bodies.  Functions whose address is not
+  // significant (unnamed_addr) are simply replaced, while the others become
+  // thunks or aliases.
+  if (MergeFunctions && ModuleOptLevel() > 0)
+    PerModulePasses->add(createMergeFunctionsPass());
+
   if (EmitIR) {
     // Emit an LLVM .ll file to the output.  This is used when passed
-    // -emit-llvm -S to the GCC driver.
+    // -emit-llvm -S to the GCC driver.  It is done as a separate "pass" so
+    // that the module can still be changed after the optimizers have run.
     InitializeOutputStreams(false);
-    PerModulePasses->add(createPrintModulePass(*OutStream));
+    CodeGenPasses = new PassManager();
+    CodeGenPasses->add(createPrintModulePass(*OutStream));
   } else {
     // If there are passes we have to run on the entire module, we do codegen
     // as a separate "pass" after that happens.
@@ -1213,7 +1293,7 @@ static void emit_global(tree decl) {
 #endif
     }
 
-    GV->setAlignment(DECL_ALIGN(decl) / 8);
+    GV->setAlignment(getDataAlignment(decl) / 8);
     assert(GV->getAlignment() != 0 && "Global variable has unknown alignment!");
 #ifdef TARGET_ADJUST_CSTRING_ALIGN
     if (DECL_INITIAL(decl) != error_mark_node && // uninitialized?
@@ -1402,6 +1482,7 @@ Value *make_decl_llvm(tree decl) {
           Function::Create(Ty, Function::ExternalLinkage, Name, TheModule);
       FnEntry->setCallingConv(CC);
       FnEntry->setAttributes(PAL);
+      FnEntry->setUnnamedAddr(!isFunctionAddressTaken(decl));
 
       // Check for external weak linkage.
       if (DECL_EXTERNAL(decl) && DECL_WEAK(decl))
@@ -1602,6 +1683,18 @@ static void FinalizePlugin(void) {
   if (Finalized)
     return;
 
+  if (flag_detailed_statistics) {
+    static const char *const Names[] = { "types", "field indices",
+                                         "initializers", "globals" };
+    const CacheKind Kinds[] = { TypeCacheKind, IndexCacheKind, ValueCacheKind,
+                                GlobalCacheKind };
+    for (unsigned i = 0; i != array_lengthof(Kinds); ++i) {
+      CacheStatistics S = getCacheStatistics(Kinds[i]);
+      errs() << "dragonegg cache (" << Names[i] << "): " << S.Hits
+             << " hits, " << S.Misses << " misses, " << S.Size << " entries\n";
+    }
+  }
+
 #ifndef NDEBUG
   delete PerModulePasses;
   delete PerFunctionPasses;
@@ -2002,6 +2095,45 @@ static void InlineAsmDiagnosticHandler(const SMDiagnostic &D, void */*Data*/,
   }
 }
 
+/// CreateLocalAliases - Redirect direct calls to exported functions defined in
+/// this unit to a local alias, so that they do not go through the PLT.  This is
+/// only correct if the functions are not interposed by another definition when
+/// linking dynamically.  Other references are left alone: the address of the
+/// function may be the PLT entry of an executable rather than the definition.
+static void CreateLocalAliases() {
+  for (Module::iterator I = TheModule->begin(), E = TheModule->end(); I != E;
+       ++I) {
+    Function *F = I;
+    if (F->isDeclaration() || !F->hasExternalLinkage() ||
+        !F->hasDefaultVisibility())
+      continue;
+    GlobalAlias *Alias = 0;
+    for (Value::use_iterator UI = F->use_begin(), UE = F->use_end();
+         UI != UE;) {
+      Use &U = *UI++;
+      CallSite CS(U.getUser());
+      if (!CS || !CS.isCallee(&U))
+        continue;
+      if (!Alias)
+        Alias = GlobalAlias::create(F->getFunctionType(), 0,
+                                    GlobalValue::InternalLinkage,
+                                    F->getName() + ".localalias", F);
+      U.set(Alias);
+    }
+  }
+}
+
+/// MarkNonLazyBind - Mark functions that are not defined in this unit as not
+/// being lazily bound, so that calls to them load the address from the GOT
+/// rather than going through the PLT.
+static void MarkNonLazyBind() {
+  for (Module::iterator I = TheModule->begin(), E = TheModule->end(); I != E;
+       ++I)
+    if (I->isDeclaration() && !I->isIntrinsic() && !I->hasLocalLinkage() &&
+        I->hasDefaultVisibility())
+      I->addFnAttr(Attribute::NonLazyBind);
+}
+
 /// llvm_finish_unit - Finish the .s file.  This is called by GCC once the
 /// compilation unit has been completely processed.
 static void llvm_finish_unit(void */*gcc_data*/, void */*user_data*/) {
@@ -2100,7 +2232,16 @@ static void llvm_finish_unit(void */*gcc_data*/, void */*user_data*/) {
   if (PerModulePasses)
     PerModulePasses->run(*TheModule);
 
-  // Run the code generator, if present.
+  // Only do this now, as GlobalOpt would replace the aliases with the aliasee
+  // and they would get in the way of inlining and the other IPO passes.
+#ifdef OBJECT_FORMAT_ELF
+  if (NoSemanticInterposition && flag_pic)
+    CreateLocalAliases();
+#endif
+  if (NoPLT)
+    MarkNonLazyBind();
+
+  // Run the code generator, or print the IR, if present.
   if (CodeGenPasses) {
     // Arrange for inline asm problems to be printed nicely.
     LLVMContext::InlineAsmDiagHandlerTy OldHandler =
@@ -2127,6 +2268,19 @@ static void llvm_finish(void */*gcc_data*/, void */*user_data*/) {
   FinalizePlugin();
 }
 
+/// llvm_ggc_marking - Called once the garbage collector has marked everything
+/// reachable.  This is the last point at which the mark bits say which trees
+/// are about to be freed, so sweep the tree caches now.
+static void llvm_ggc_marking(void */*gcc_data*/, void */*user_data*/) {
+  sweepCaches();
+}
+
+/// llvm_ggc_end - Called after GCC garbage collected.  Trees may have been
+/// freed and their memory reused, so drop everything memoized by tree address.
+static void llvm_ggc_end(void */*gcc_data*/, void */*user_data*/) {
+  InvalidateFunctionTypeCaches();
+}
+
 //Condition added by Arun
 #if (GCC_MINOR <= 8)
 //End of lines added by Arun
@@ -2446,9 +2600,6 @@ pass_simple_ipa_null pass_simple_ipa_null(g);
 #endif                         /* #if (GCC_MINOR <= 8) */
 //End of lines added by Arun
 
-// Garbage collector roots.
-extern const struct ggc_cache_tab gt_ggc_rc__gt_cache_h[];
-
 /// PluginFlags - Flag arguments for the plugin.
 
 struct FlagDescriptor {
@@ -2460,7 +2611,9 @@ static FlagDescriptor PluginFlags[] = {
   { "debug-pass-structure", &DebugPassStructure },
   { "debug-pass-arguments", &DebugPassArguments },
   { "enable-gcc-optzns", &EnableGCCOptimizations }, { "emit-ir", &EmitIR },
-  { "emit-obj", &EmitObj },
+  { "emit-obj", &EmitObj }, { "merge-functions", &MergeFunctions },
+  { "no-plt", &NoPLT },
+  { "no-semantic-interposition", &NoSemanticInterposition },
   { "save-gcc-output", &SaveGCCOutput }, { NULL, NULL } // Terminator.
 };
 
@@ -2592,9 +2745,11 @@ int __attribute__((visibility("default"))) plugin_init(
   // writing anything at all to the assembly file - only we get to write to it.
   TakeoverAsmOutput();
 
-  // Register our garbage collector roots.
-  register_callback(plugin_name, PLUGIN_REGISTER_GGC_CACHES, NULL,
-                    const_cast<ggc_cache_tab *>(gt_ggc_rc__gt_cache_h));
+  // Drop cached values for trees that are about to be garbage collected.
+  register_callback(plugin_name, PLUGIN_GGC_MARKING, llvm_ggc_marking, NULL);
+
+  // Forget cached function type lowerings when trees are garbage collected.
+  register_callback(plugin_name, PLUGIN_GGC_END, llvm_ggc_end, NULL);
 
   // Perform late initialization just before processing the compilation unit.
   register_callback(plugin_name, PLUGIN_START_UNIT, llvm_start_unit, NULL);
@@ -21,13 +21,22 @@
 // This code lets you associate values with a tree, as if it were cached inside
 // the tree: if the tree is garbage collected and reallocated, then the cached
 // value will have been cleared.
+//
+// The tables live outside of GCC's garbage collected memory.  Types, field
+// indices, initializer values and global declarations each get a table of
+// their own, so lookups in one kind of table do not have to wade through the
+// entries of the others.  Entries keyed by trees that did not survive garbage
+// collection are swept out by sweepCaches, which the plugin runs while the
+// collector's mark bits are still valid.
 //===----------------------------------------------------------------------===//
 
 // Plugin headers.
 #include "dragonegg/Cache.h"
 
 // LLVM headers
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/ErrorHandling.h"
 
 // System headers
 #include <cassert>
@@ -54,193 +63,168 @@ extern "C" {
 
 using namespace llvm;
 
-// Hash table mapping trees to integers.
-
-struct GTY(()) tree2int {
-  struct tree_map_base base;
-  int GTY((skip)) val;
-};
-
-#define tree2int_eq tree_map_base_eq
-#define tree2int_hash tree_map_base_hash
-#define tree2int_marked_p tree_map_base_marked_p
-
-static GTY((if_marked("tree2int_marked_p"), param_is(struct tree2int)))
-    htab_t intCache;
-
-// Hash table mapping trees to Type*.
+namespace {
+
+/// TreeCache - A side table associating values of type ValueT with trees.
+/// This is an open-addressing hash table keyed on the tree's address, so a
+/// lookup is a couple of probes into a flat array.  It keeps its own hit and
+/// miss counts, which are reported by getCacheStatistics.
+template <typename ValueT> class TreeCache {
+  typedef DenseMap<tree, ValueT> MapTy;
+  MapTy Map;
+  unsigned Hits, Misses;
+
+public:
+  TreeCache() : Hits(0), Misses(0) {}
+
+  /// lookup - Returns the slot holding the value cached for the given tree, or
+  /// null if there is none.
+  ValueT *lookup(tree t) {
+    typename MapTy::iterator I = Map.find(t);
+    return I == Map.end() ? 0 : &I->second;
+  }
 
-// Forward declare Type for the benefit of gengtype.
-#ifndef IN_GCC
-struct Type;
-#endif
-struct GTY(()) tree2Type {
-  struct tree_map_base base;
-#ifndef IN_GCC
-  struct
-#endif
-      Type *
-          GTY((skip)) Ty;
-};
+  /// insert - Returns the slot holding the value for the given tree, creating
+  /// it if need be.
+  ValueT &insert(tree t) { return Map[t]; }
 
-#define tree2Type_eq tree_map_base_eq
-#define tree2Type_hash tree_map_base_hash
-#define tree2Type_marked_p tree_map_base_marked_p
+  /// erase - Forget any value cached for the given tree.
+  void erase(tree t) { Map.erase(t); }
 
-static GTY((if_marked("tree2Type_marked_p"), param_is(struct tree2Type)))
-    htab_t TypeCache;
+  /// sweep - Drop all entries for trees that were not marked by the garbage
+  /// collector.
+  void sweep() {
+    for (typename MapTy::iterator I = Map.begin(), E = Map.end(); I != E; ++I)
+      if (!ggc_marked_p(I->first))
+        Map.erase(I);
+  }
 
-// Hash table mapping trees to WeakVH.
+  unsigned size() const { return Map.size(); }
+  unsigned hits() const { return Hits; }
+  unsigned misses() const { return Misses; }
 
-// Forward declare WeakVH for the benefit of gengtype.
-#ifndef IN_GCC
-struct WeakVH;
-#endif
-struct GTY(()) tree2WeakVH {
-  struct tree_map_base base;
-#ifndef IN_GCC
-  struct
-#endif
-      WeakVH
-          GTY((skip)) V;
+  /// hit, miss - Count the outcome of a lookup.
+  void hit() { ++Hits; }
+  void miss() { ++Misses; }
 };
 
-#define tree2WeakVH_eq tree_map_base_eq
-#define tree2WeakVH_hash tree_map_base_hash
-#define tree2WeakVH_marked_p tree_map_base_marked_p
+} // Unnamed namespace.
 
-static GTY((if_marked("tree2WeakVH_marked_p"), param_is(struct tree2WeakVH)))
-    htab_t WeakVHCache;
-
-// Include the garbage collector header.
-#ifndef ENABLE_BUILD_WITH_CXX
-extern "C" {
-#endif
-#if (GCC_MINOR > 5)
-#include "dragonegg/gt-cache-4.6.inc"
-#else
-#include "dragonegg/gt-cache-4.5.inc"
-#endif
-#ifndef ENABLE_BUILD_WITH_CXX
-} // extern "C"
-#endif
+static TreeCache<Type *> TypeCache;
+static TreeCache<int> IndexCache;
+static TreeCache<WeakVH> ValueCache;
+static TreeCache<WeakVH> GlobalCache;
 
 bool getCachedInteger(tree t, int &Val) {
-  if (!intCache)
+  int *Slot = IndexCache.lookup(t);
+  if (!Slot) {
+    IndexCache.miss();
     return false;
-  tree_map_base in = { t };
-  tree2int *h = (tree2int *)htab_find(intCache, &in);
-  if (!h)
-    return false;
-  Val = h->val;
+  }
+  IndexCache.hit();
+  Val = *Slot;
   return true;
 }
 
 void setCachedInteger(tree t, int Val) {
-  if (!intCache)
-    intCache = htab_create_ggc(1024, tree2int_hash, tree2int_eq, 0);
-
-  tree_map_base in = { t };
-  tree2int **slot = (tree2int **)htab_find_slot(intCache, &in, INSERT);
-  assert(slot && "Failed to create hash table slot!");
-
-  if (!*slot) {
-    *slot =
-#if (GCC_MINOR > 5)
-        ggc_alloc_tree2int();
-#else
-    GGC_NEW(struct tree2int);
-#endif
-    (*slot)->base.from = t;
-  }
-
-  (*slot)->val = Val;
+  IndexCache.insert(t) = Val;
 }
 
 Type *getCachedType(tree t) {
-  if (!TypeCache)
+  Type **Slot = TypeCache.lookup(t);
+  if (!Slot) {
+    TypeCache.miss();
     return 0;
-  tree_map_base in = { t };
-  tree2Type *h = (tree2Type *)htab_find(TypeCache, &in);
-  return h ? h->Ty : 0;
+  }
+  TypeCache.hit();
+  return *Slot;
 }
 
 void setCachedType(tree t, Type *Ty) {
-  tree_map_base in = { t };
-
-  /* If deleting, remove the slot.  */
+  // If deleting, remove the slot.
   if (!Ty) {
-    if (TypeCache)
-      htab_remove_elt(TypeCache, &in);
+    TypeCache.erase(t);
     return;
   }
-
-  if (!TypeCache)
-    TypeCache = htab_create_ggc(1024, tree2Type_hash, tree2Type_eq, 0);
-
-  tree2Type **slot = (tree2Type **)htab_find_slot(TypeCache, &in, INSERT);
-  assert(slot && "Failed to create hash table slot!");
-
-  if (!*slot) {
-    *slot =
-#if (GCC_MINOR > 5)
-        ggc_alloc_tree2Type();
-#else
-    GGC_NEW(struct tree2Type);
-#endif
-    (*slot)->base.from = t;
-  }
-
-  (*slot)->Ty = Ty;
+  TypeCache.insert(t) = Ty;
 }
 
 /// getCachedValue - Returns the value associated with the given GCC tree, or
 /// null if none.
 Value *getCachedValue(tree t) {
-  if (!WeakVHCache)
+  WeakVH *Slot = ValueCache.lookup(t);
+  // A value that has been deleted leaves a null handle behind.
+  if (!Slot || !*Slot) {
+    ValueCache.miss();
     return 0;
-  tree_map_base in = { t };
-  tree2WeakVH *h = (tree2WeakVH *)htab_find(WeakVHCache, &in);
-  return h ? h->V : 0;
-}
-
-static void DestructWeakVH(void *p) {
-  ((WeakVH *)&((tree2WeakVH *)p)->V)->~WeakVH();
+  }
+  ValueCache.hit();
+  return *Slot;
 }
 
 /// setCachedValue - Associates the given value (which may be null) with the
 /// given GCC tree.  The association is removed if tree is garbage collected
 /// or the value deleted.
 void setCachedValue(tree t, Value *V) {
-  tree_map_base in = { t };
-
   // If deleting, remove the slot.
   if (!V) {
-    if (WeakVHCache)
-      htab_remove_elt(WeakVHCache, &in);
+    ValueCache.erase(t);
     return;
   }
+  ValueCache.insert(t) = V;
+}
 
-  if (!WeakVHCache)
-    WeakVHCache =
-        htab_create_ggc(1024, tree2WeakVH_hash, tree2WeakVH_eq, DestructWeakVH);
-
-  tree2WeakVH **slot = (tree2WeakVH **)htab_find_slot(WeakVHCache, &in, INSERT);
-  assert(slot && "Failed to create hash table slot!");
+/// getCachedGlobal - Returns the global value associated with the given GCC
+/// declaration, or null if none.
+Value *getCachedGlobal(tree t) {
+  WeakVH *Slot = GlobalCache.lookup(t);
+  if (!Slot || !*Slot) {
+    GlobalCache.miss();
+    return 0;
+  }
+  GlobalCache.hit();
+  return *Slot;
+}
 
-  if (*slot) {
-    (*slot)->V = V;
+/// setCachedGlobal - Associates the given global value (which may be null)
+/// with the given GCC declaration.
+void setCachedGlobal(tree t, Value *V) {
+  // If deleting, remove the slot.
+  if (!V) {
+    GlobalCache.erase(t);
     return;
   }
+  GlobalCache.insert(t) = V;
+}
 
-  *slot =
-#if (GCC_MINOR > 5)
-      ggc_alloc_tree2WeakVH();
-#else
-  GGC_NEW(struct tree2WeakVH);
-#endif
-  (*slot)->base.from = t;
-  WeakVH *W = new (&(*slot)->V) WeakVH(V);
-  assert(W == &(*slot)->V && "Pointer was displaced!");
-  (void)W;
+/// sweepCaches - Forget everything cached for trees that the garbage collector
+/// did not mark.
+void sweepCaches() {
+  TypeCache.sweep();
+  IndexCache.sweep();
+  ValueCache.sweep();
+  GlobalCache.sweep();
+}
+
+/// StatisticsFor - The hit, miss and size counters of the given table.
+template <typename ValueT>
+static CacheStatistics StatisticsFor(const TreeCache<ValueT> &Cache) {
+  CacheStatistics S = { Cache.hits(), Cache.misses(), Cache.size() };
+  return S;
+}
+
+/// getCacheStatistics - Returns the hit, miss and size counters of the given
+/// table.
+CacheStatistics getCacheStatistics(CacheKind Kind) {
+  switch (Kind) {
+  case TypeCacheKind:
+    return StatisticsFor(TypeCache);
+  case IndexCacheKind:
+    return StatisticsFor(IndexCache);
+  case ValueCacheKind:
+    return StatisticsFor(ValueCache);
+  case GlobalCacheKind:
+    return StatisticsFor(GlobalCache);
+  }
+  llvm_unreachable("Unknown cache kind!");
 }
@@ -740,6 +740,29 @@ static Constant *ConvertCST(tree exp, TargetFolder &) {
   return ConstantDataArray::get(Context, Buffer);
 }
 
+/// StringToDataArray - Return a constant array holding the first NumElts
+/// characters of the given string, which has LenInElts characters of type IntT
+/// in target byte order.  If the string is too short then the array is padded
+/// out with nulls.
+template <typename IntT>
+static Constant *
+StringToDataArray(const char *Str, unsigned LenInElts, unsigned NumElts) {
+  std::vector<IntT> Elts(NumElts);
+  unsigned NumCopied = std::min(LenInElts, NumElts);
+  if (!NumCopied)
+    return ConstantDataArray::get(Context, Elts);
+  memcpy(&Elts[0], Str, NumCopied * sizeof(IntT));
+  // GCC has constructed the characters in the target endianness, but we're
+  // going to treat them as ordinary integers from here, with host endianness.
+  // Adjust if necessary.
+  if (sizeof(IntT) > 1 && llvm::sys::IsBigEndianHost != BYTES_BIG_ENDIAN)
+    for (unsigned i = 0; i != NumCopied; ++i) {
+      char *Bytes = (char *)&Elts[i];
+      std::reverse(Bytes, Bytes + sizeof(IntT));
+    }
+  return ConstantDataArray::get(Context, Elts);
+}
+
 static Constant *ConvertSTRING_CST(tree exp, TargetFolder &) {
   // TODO: Enhance GCC's native_encode_expr to handle arbitrary strings and not
   // just those with a byte component type; then ConvertCST can handle strings.
@@ -747,74 +770,368 @@ static Constant *ConvertSTRING_CST(tree exp, TargetFolder &) {
   Type *ElTy = StrTy->getElementType();
 
   unsigned Len = (unsigned) TREE_STRING_LENGTH(exp);
+  unsigned LenInElts =
+      Len / TREE_INT_CST_LOW(TYPE_SIZE_UNIT(main_type(main_type(exp))));
+  unsigned ConstantSize = StrTy->getNumElements();
 
-  std::vector<Constant *> Elts;
-  if (ElTy->isIntegerTy(8)) {
-    const unsigned char *InStr =
-        (const unsigned char *)TREE_STRING_POINTER(exp);
-    for (unsigned i = 0; i != Len; ++i)
-      Elts.push_back(ConstantInt::get(Type::getInt8Ty(Context), InStr[i]));
-  } else if (ElTy->isIntegerTy(16)) {
+  // If this is a variable sized array type, set the length to LenInElts.
+  if (LenInElts != ConstantSize && ConstantSize == 0) {
+    tree Domain = TYPE_DOMAIN(main_type(exp));
+    if (!Domain || !TYPE_MAX_VALUE(Domain))
+      ConstantSize = LenInElts;
+  }
+
+  // Build the array directly from the string contents.  If only some chars are
+  // being used then the string is truncated: char X[2] = "foo"; if it is too
+  // short then it is filled out with nulls.
+  const char *Str = TREE_STRING_POINTER(exp);
+  if (ElTy->isIntegerTy(8))
+    return StringToDataArray<uint8_t>(Str, LenInElts, ConstantSize);
+  if (ElTy->isIntegerTy(16)) {
     assert((Len & 1) == 0 &&
            "Length in bytes should be a multiple of element size");
-    const uint16_t *InStr = (const unsigned short *)TREE_STRING_POINTER(exp);
-    for (unsigned i = 0; i != Len / 2; ++i) {
-      // gcc has constructed the initializer elements in the target endianness,
-      // but we're going to treat them as ordinary shorts from here, with
-      // host endianness.  Adjust if necessary.
-      if (llvm::sys::IsBigEndianHost == BYTES_BIG_ENDIAN)
-        Elts.push_back(ConstantInt::get(Type::getInt16Ty(Context), InStr[i]));
-      else
-        Elts.push_back(
-            ConstantInt::get(Type::getInt16Ty(Context), ByteSwap_16(InStr[i])));
-    }
-  } else if (ElTy->isIntegerTy(32)) {
+    return StringToDataArray<uint16_t>(Str, LenInElts, ConstantSize);
+  }
+  if (ElTy->isIntegerTy(32)) {
     assert((Len & 3) == 0 &&
            "Length in bytes should be a multiple of element size");
-    const uint32_t *InStr = (const uint32_t *)TREE_STRING_POINTER(exp);
-    for (unsigned i = 0; i != Len / 4; ++i) {
-      // gcc has constructed the initializer elements in the target endianness,
-      // but we're going to treat them as ordinary ints from here, with
-      // host endianness.  Adjust if necessary.
-      if (llvm::sys::IsBigEndianHost == BYTES_BIG_ENDIAN)
-        Elts.push_back(ConstantInt::get(Type::getInt32Ty(Context), InStr[i]));
-      else
-        Elts.push_back(
-            ConstantInt::get(Type::getInt32Ty(Context), ByteSwap_32(InStr[i])));
+    return StringToDataArray<uint32_t>(Str, LenInElts, ConstantSize);
+  }
+  llvm_unreachable("Unknown character type!");
+}
+
+static Constant *ConvertADDR_EXPR(tree exp, TargetFolder &Folder) {
+  return AddressOfImpl(TREE_OPERAND(exp, 0), Folder);
+}
+
+/// GetElementRange - Work out which array elements the initial value with the
+/// given index in an array CONSTRUCTOR applies to: the elements with index in
+/// [FirstIndex, LastIndex].  The index may be null, which means that the value
+/// belongs in the next available slot, NextIndex.  If lower_bnd is not null
+/// then it is subtracted off GCC indices to make them zero based.
+static void GetElementRange(tree index, tree lower_bnd, unsigned NextIndex,
+                            unsigned &FirstIndex, unsigned &LastIndex) {
+  if (!index) {
+    LastIndex = FirstIndex = NextIndex;
+  } else if (isa<RANGE_EXPR>(index)) {
+    tree first = TREE_OPERAND(index, 0);
+    tree last = TREE_OPERAND(index, 1);
+
+    // Subtract off the lower bound if any to ensure indices start from zero.
+    if (lower_bnd != NULL_TREE) {
+      first = fold_build2(MINUS_EXPR, main_type(first), first, lower_bnd);
+      last = fold_build2(MINUS_EXPR, main_type(last), last, lower_bnd);
     }
+
+    assert(host_integerp(first, 1) && host_integerp(last, 1) &&
+           "Unknown range_expr!");
+//Below condition added by Arun
+#if (GCC_MINOR <= 8)
+//End of lines added by Arun
+    FirstIndex = tree_low_cst(first, 1);
+    LastIndex = tree_low_cst(last, 1);
+//Below lines added by Arun in attempt to compile using gcc 4.9
+#else
+    FirstIndex = tree_to_uhwi(first);
+    LastIndex = tree_to_uhwi(last);
+#endif
+//End of lines added by Arun
   } else {
-    llvm_unreachable("Unknown character type!");
+    // Subtract off the lower bound if any to ensure indices start from zero.
+    if (lower_bnd != NULL_TREE)
+      index = fold_build2(MINUS_EXPR, main_type(index), index, lower_bnd);
+    assert(host_integerp(index, 1));
+//Below condition added by Arun
+#if (GCC_MINOR <= 8)
+//End of lines added by Arun
+    FirstIndex = tree_low_cst(index, 1);
+//Below lines added by Arun in attempt to compile using gcc 4.9
+#else
+    FirstIndex = tree_to_uhwi(index);
+#endif
+//End of lines added by Arun
+    LastIndex = FirstIndex;
   }
+}
 
-  unsigned LenInElts =
-      Len / TREE_INT_CST_LOW(TYPE_SIZE_UNIT(main_type(main_type(exp))));
-  unsigned ConstantSize = StrTy->getNumElements();
+/// EncodeDataArray - Encode the initial values of the array constructor exp,
+/// all simple constants of type elt_type, into a constant array with elements
+/// of type EltT, which has the same size as the integer type IntT.  The values
+/// are staged at their final width, so a table of bytes only needs a byte per
+/// element.  Returns null if some initial value is not of this kind, or if
+/// fewer than MinElts elements were initialized.
+template <typename IntT, typename EltT>
+static Constant *EncodeDataArray(tree exp, tree lower_bnd, uint64_t TypeElts,
+                                 tree elt_type, uint64_t MinElts) {
+  std::vector<EltT> Elts;
+  if (TypeElts != NO_LENGTH)
+    Elts.resize(TypeElts);
 
-  if (LenInElts != ConstantSize) {
-    // If this is a variable sized array type, set the length to LenInElts.
-    if (ConstantSize == 0) {
-      tree Domain = TYPE_DOMAIN(main_type(exp));
-      if (!Domain || !TYPE_MAX_VALUE(Domain)) {
-        ConstantSize = LenInElts;
-        StrTy = ArrayType::get(ElTy, LenInElts);
-      }
-    }
+  bool isLittleEndian = getDataLayout().isLittleEndian();
+  unsigned char Buffer[sizeof(EltT)];
+  unsigned NextIndex = 0;
+  unsigned HOST_WIDE_INT ix;
+  tree elt_index, elt_value;
+  FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(exp), ix, elt_index, elt_value) {
+    if ((!isa<INTEGER_CST>(elt_value) && !isa<REAL_CST>(elt_value)) ||
+        main_type(elt_value) != elt_type)
+      return 0;
 
-    if (ConstantSize < LenInElts) {
-      // Only some chars are being used, truncate the string: char X[2] = "foo";
-      Elts.resize(ConstantSize);
-    } else {
-      // Fill the end of the string with nulls.
-      Constant *C = Constant::getNullValue(ElTy);
-      for (; LenInElts != ConstantSize; ++LenInElts)
-        Elts.push_back(C);
-    }
+    // Encode the constant in target format, then read it back as an integer.
+    if (native_encode_expr(elt_value, Buffer, sizeof(EltT)) !=
+        (int) sizeof(EltT))
+      return 0;
+    IntT Bits = 0;
+    for (unsigned i = 0; i != sizeof(EltT); ++i)
+      Bits = (Bits << 8) |
+             Buffer[isLittleEndian ? sizeof(EltT) - 1 - i : i];
+    EltT Val;
+    memcpy(&Val, &Bits, sizeof(EltT));
+
+    // The first and last elements to fill in, inclusive.
+    unsigned FirstIndex, LastIndex;
+    GetElementRange(elt_index, lower_bnd, NextIndex, FirstIndex, LastIndex);
+    if (LastIndex >= Elts.size())
+      Elts.resize(LastIndex + 1);
+    for (; FirstIndex <= LastIndex; ++FirstIndex)
+      Elts[FirstIndex] = Val;
+    NextIndex = FirstIndex;
   }
-  return ConstantArray::get(StrTy, Elts);
+
+  if (Elts.empty() || Elts.size() < MinElts)
+    return 0;
+  return ConstantDataArray::get(Context, Elts);
 }
 
-static Constant *ConvertADDR_EXPR(tree exp, TargetFolder &Folder) {
-  return AddressOfImpl(TREE_OPERAND(exp, 0), Folder);
+/// ConvertScalarArrayCONSTRUCTOR - Fast path for ConvertArrayCONSTRUCTOR for
+/// arrays of integers or floating point numbers where every initial value is a
+/// simple constant of the element type, the usual case for big lookup tables.
+/// Rather than converting each initial value to an LLVM constant, the values
+/// are encoded straight into a ConstantDataArray.  Returns null if the array
+/// is not of this kind.
+static Constant *
+ConvertScalarArrayCONSTRUCTOR(tree exp, tree lower_bnd, uint64_t TypeElts) {
+  tree init_type = main_type(exp);
+  if (!isa<ARRAY_TYPE>(init_type))
+    return 0;
+  // A ConstantDataArray can hold zeros for the elements that have no initial
+  // value, but not undefined values.
+  if (!flag_default_initialize_globals)
+    return 0;
+
+  tree elt_type = main_type(init_type);
+  if (!isa<INTEGRAL_TYPE>(elt_type) && !isa<REAL_TYPE>(elt_type))
+    return 0;
+  Type *EltTy = ConvertType(elt_type);
+  if (!EltTy->isIntegerTy(8) && !EltTy->isIntegerTy(16) &&
+      !EltTy->isIntegerTy(32) && !EltTy->isIntegerTy(64) &&
+      !EltTy->isFloatTy() && !EltTy->isDoubleTy())
+    return 0;
+
+  // The LLVM element type must exactly cover the GCC one, and the array must
+  // be at least as aligned as its elements, otherwise ConvertArrayCONSTRUCTOR
+  // needs to do something special.
+  const DataLayout &DL = getDataLayout();
+  unsigned EltBytes = DL.getTypeAllocSize(EltTy);
+  if (!isInt64(TYPE_SIZE(elt_type), true) ||
+      getInt64(TYPE_SIZE(elt_type), true) != EltBytes * BITS_PER_UNIT ||
+      DL.getABITypeAlignment(EltTy) * 8 > TYPE_ALIGN(init_type))
+    return 0;
+
+  // Leave zero length arrays, and arrays needing tail padding to be as big as
+  // their LLVM type, to the general logic.
+  uint64_t TypeSize = DL.getTypeAllocSizeInBits(ConvertType(init_type));
+  uint64_t EltBits = EltBytes * BITS_PER_UNIT;
+  uint64_t MinElts = (TypeSize + EltBits - 1) / EltBits;
+
+  if (EltTy->isFloatTy())
+    return EncodeDataArray<uint32_t, float>(exp, lower_bnd, TypeElts, elt_type,
+                                            MinElts);
+  if (EltTy->isDoubleTy())
+    return EncodeDataArray<uint64_t, double>(exp, lower_bnd, TypeElts,
+                                             elt_type, MinElts);
+  switch (EltBytes) {
+  default:
+    llvm_unreachable("Unexpected integer size!");
+  case 1:
+    return EncodeDataArray<uint8_t, uint8_t>(exp, lower_bnd, TypeElts,
+                                             elt_type, MinElts);
+  case 2:
+    return EncodeDataArray<uint16_t, uint16_t>(exp, lower_bnd, TypeElts,
+                                               elt_type, MinElts);
+  case 4:
+    return EncodeDataArray<uint32_t, uint32_t>(exp, lower_bnd, TypeElts,
+                                               elt_type, MinElts);
+  case 8:
+    return EncodeDataArray<uint64_t, uint64_t>(exp, lower_bnd, TypeElts,
+                                               elt_type, MinElts);
+  }
+}
+
+/// ConvertArrayElement - Convert the initial value for an array element of the
+/// given GCC type and size in bits, padding it out to the element size if it is
+/// smaller.
+static Constant *ConvertArrayElement(tree value, tree elt_type,
+                                     uint64_t EltSize, TargetFolder &Folder) {
+  Constant *Val = ConvertInitializerWithCast(value, elt_type, Folder);
+  uint64_t ValSize = getDataLayout().getTypeAllocSizeInBits(Val->getType());
+  assert(ValSize <= EltSize && "Element initial value too big!");
+
+  // If the initial value is smaller than the element size then pad it out.
+  if (ValSize < EltSize) {
+    unsigned PadBits = EltSize - ValSize;
+    assert(PadBits % BITS_PER_UNIT == 0 && "Non-unit type size?");
+    unsigned Units = PadBits / BITS_PER_UNIT;
+    Constant *PaddedElt[] = { Val,
+                              getDefaultValue(GetUnitType(Context, Units)) };
+
+    Val = ConstantStruct::getAnon(PaddedElt);
+  }
+  return Val;
+}
+
+/// GetRepeatedArray - Return a constant holding Len copies of Val.  Null values
+/// become a zeroinitializer.  Long runs of any other value are built as an array
+/// of arrays, {[Rows x [Cols x T]], [Rest x T]}, which has the same layout as
+/// [Len x T] but only needs about sqrt(Len) copies of Val to be created.
+static Constant *GetRepeatedArray(Constant *Val, uint64_t Len) {
+  Type *Ty = Val->getType();
+  if (Val->isNullValue())
+    return Constant::getNullValue(ArrayType::get(Ty, Len));
+  if (Len <= 64)
+    return ConstantArray::get(ArrayType::get(Ty, Len),
+                              std::vector<Constant *>(Len, Val));
+
+  uint64_t Cols = 8;
+  while (Cols * Cols < Len)
+    Cols *= 2;
+  Cols /= 2;
+  uint64_t Rows = Len / Cols, Rest = Len % Cols;
+  Constant *Row = ConstantArray::get(ArrayType::get(Ty, Cols),
+                                     std::vector<Constant *>(Cols, Val));
+  Constant *Block =
+      ConstantArray::get(ArrayType::get(Row->getType(), Rows),
+                         std::vector<Constant *>(Rows, Row));
+  if (!Rest)
+    return Block;
+  Constant *Parts[] = { Block, GetRepeatedArray(Val, Rest) };
+  return ConstantStruct::getAnon(Parts);
+}
+
+namespace {
+
+/// ElementRun - A run of consecutive array elements sharing an initial value.
+class ElementRun {
+  Range<uint64_t> R; // The indices of the elements in the run.
+  Constant *Val;     // The initial value of each element.
+
+public:
+  ElementRun(uint64_t First, uint64_t Last, Constant *val)
+      : R(First, Last), Val(val) {}
+
+  Range<uint64_t> getRange() const { return R; }
+  void ChangeRangeTo(Range<uint64_t> r) { R = r; }
+  void JoinWith(const ElementRun &S) {
+    assert(Val == S.Val && "Joining runs with different values!");
+    R = R.Join(S.R);
+  }
+  Constant *getValue() const { return Val; }
+};
+
+} // Unnamed namespace.
+
+/// ConvertSparseArrayCONSTRUCTOR - Convert an array CONSTRUCTOR that gives the
+/// same initial value to long ranges of elements, like [0 ... 999999] = x, or
+/// that only initializes a few elements of a big array.  The initial values are
+/// held as runs of elements rather than one per element, and each run becomes
+/// a single piece of the resulting struct, so the cost is proportional to the
+/// number of runs rather than to the length of the array.  Returns null if the
+/// array is not of this kind.
+static Constant *ConvertSparseArrayCONSTRUCTOR(tree exp, tree lower_bnd,
+                                               uint64_t TypeElts,
+                                               TargetFolder &Folder) {
+  tree init_type = main_type(exp);
+  if (!isa<ARRAY_TYPE>(init_type))
+    return 0;
+
+  // Work out the number of elements and an upper bound for the number of runs
+  // without converting any initial values: each initial value gives one run,
+  // which may be followed by a run of default initialized elements.
+  uint64_t NumElts = TypeElts == NO_LENGTH ? 0 : TypeElts;
+  uint64_t MaxRuns = 1;
+  unsigned NextIndex = 0;
+  unsigned HOST_WIDE_INT ix;
+  tree elt_index, elt_value;
+  FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(exp), ix, elt_index, elt_value) {
+    unsigned FirstIndex, LastIndex;
+    GetElementRange(elt_index, lower_bnd, NextIndex, FirstIndex, LastIndex);
+    NumElts = std::max(NumElts, (uint64_t) LastIndex + 1);
+    MaxRuns += 2;
+    NextIndex = LastIndex + 1;
+  }
+  // Small or densely initialized arrays are better off as a plain array.
+  if (NumElts < 1024 || NumElts / MaxRuns < 16)
+    return 0;
+
+  const DataLayout &DL = getDataLayout();
+  tree elt_type = main_type(init_type);
+  Type *EltTy = ConvertType(elt_type);
+  uint64_t EltSize = DL.getTypeAllocSizeInBits(EltTy);
+
+  SmallVector<ElementRun, 16> Runs;
+  NextIndex = 0;
+  FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(exp), ix, elt_index, elt_value) {
+    Constant *Val = ConvertArrayElement(elt_value, elt_type, EltSize, Folder);
+    unsigned FirstIndex, LastIndex;
+    GetElementRange(elt_index, lower_bnd, NextIndex, FirstIndex, LastIndex);
+    Runs.push_back(ElementRun(FirstIndex, (uint64_t) LastIndex + 1, Val));
+    NextIndex = LastIndex + 1;
+  }
+
+  // Sort the runs, with later initial values overriding earlier ones for the
+  // same element.
+  IntervalList<ElementRun, uint64_t, 16> Layout;
+  Layout.AddIntervals(Runs.begin(), Runs.end());
+
+  // Turn each run into an array, default initializing the gaps between them.
+  // While there, compute the maximum element alignment.
+  std::vector<Constant *> Pieces;
+  unsigned MaxAlign = DL.getABITypeAlignment(EltTy);
+  uint64_t EndOfLastRun = 0;
+  for (unsigned i = 0, e = Layout.getNumIntervals(); i != e; ++i) {
+    const ElementRun &Run = Layout.getInterval(i);
+    uint64_t First = Run.getRange().getFirst();
+    uint64_t Last = Run.getRange().getLast();
+    if (First > EndOfLastRun)
+      Pieces.push_back(
+          getDefaultValue(ArrayType::get(EltTy, First - EndOfLastRun)));
+    Constant *Val = Run.getValue();
+    MaxAlign = std::max(DL.getABITypeAlignment(Val->getType()), MaxAlign);
+    Pieces.push_back(Last - First == 1 ? Val
+                                       : GetRepeatedArray(Val, Last - First));
+    EndOfLastRun = Last;
+  }
+  if (NumElts > EndOfLastRun)
+    Pieces.push_back(
+        getDefaultValue(ArrayType::get(EltTy, NumElts - EndOfLastRun)));
+
+  // We guarantee that initializers are always at least as big as the LLVM type
+  // for the initializer.  If needed, append padding to ensure this.
+  uint64_t TypeSize = DL.getTypeAllocSizeInBits(ConvertType(init_type));
+  if (NumElts * EltSize < TypeSize) {
+    uint64_t PadBits = TypeSize - NumElts * EltSize;
+    assert(PadBits % BITS_PER_UNIT == 0 && "Non-unit type size?");
+    Pieces.push_back(
+        getDefaultValue(GetUnitType(Context, PadBits / BITS_PER_UNIT)));
+  }
+
+  // If any elements are more aligned than the GCC type then we need to return a
+  // packed struct.  This can happen if the user forced a small alignment on the
+  // array type.
+  bool Packed = MaxAlign * 8 > TYPE_ALIGN(init_type);
+  if (Pieces.size() == 1 && !Packed)
+    return Pieces[0];
+  return ConstantStruct::getAnon(Context, Pieces, Packed);
 }
 
 /// ConvertArrayCONSTRUCTOR - Convert a CONSTRUCTOR with array or vector type.
@@ -831,18 +1148,10 @@ static Constant *ConvertArrayCONSTRUCTOR(tree exp, TargetFolder &Folder) {
   assert(isSizeCompatible(elt_type) && "Variable sized array element!");
   uint64_t EltSize = DL.getTypeAllocSizeInBits(EltTy);
 
-  /// Elts - The initial values to use for the array elements.  A null entry
-  /// means that the corresponding array element should be default initialized.
-  std::vector<Constant *> Elts;
-
-  // Resize to the number of array elements if known.  This ensures that every
-  // element will be at least default initialized even if no initial value is
-  // given for it.
+  // The number of array elements, if known.
   uint64_t TypeElts =
       isa<ARRAY_TYPE>(init_type) ? ArrayLengthOf(init_type)
                                  : TYPE_VECTOR_SUBPARTS(init_type);
-  if (TypeElts != NO_LENGTH)
-    Elts.resize(TypeElts);
 
   // If GCC indices into the array need adjusting to make them zero indexed then
   // record here the value to subtract off.
@@ -851,73 +1160,36 @@ static Constant *ConvertArrayCONSTRUCTOR(tree exp, TargetFolder &Folder) {
       !integer_zerop(TYPE_MIN_VALUE(TYPE_DOMAIN(init_type))))
     lower_bnd = TYPE_MIN_VALUE(TYPE_DOMAIN(init_type));
 
+  // Initializers made up of a few long runs of elements, for example because
+  // most of the array is default initialized, are best built run by run.
+  if (Constant *C =
+          ConvertSparseArrayCONSTRUCTOR(exp, lower_bnd, TypeElts, Folder))
+    return C;
+
+  // Big tables of numbers can be output much more efficiently.
+  if (Constant *C = ConvertScalarArrayCONSTRUCTOR(exp, lower_bnd, TypeElts))
+    return C;
+
+  /// Elts - The initial values to use for the array elements.  A null entry
+  /// means that the corresponding array element should be default initialized.
+  std::vector<Constant *> Elts;
+
+  // Resize to the number of array elements if known.  This ensures that every
+  // element will be at least default initialized even if no initial value is
+  // given for it.
+  if (TypeElts != NO_LENGTH)
+    Elts.resize(TypeElts);
+
   unsigned NextIndex = 0;
   unsigned HOST_WIDE_INT ix;
   tree elt_index, elt_value;
   FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(exp), ix, elt_index, elt_value) {
     // Find and decode the constructor's value.
-    Constant *Val = ConvertInitializerWithCast(elt_value, elt_type, Folder);
-    uint64_t ValSize = DL.getTypeAllocSizeInBits(Val->getType());
-    assert(ValSize <= EltSize && "Element initial value too big!");
-
-    // If the initial value is smaller than the element size then pad it out.
-    if (ValSize < EltSize) {
-      unsigned PadBits = EltSize - ValSize;
-      assert(PadBits % BITS_PER_UNIT == 0 && "Non-unit type size?");
-      unsigned Units = PadBits / BITS_PER_UNIT;
-      Constant *PaddedElt[] = { Val,
-                                getDefaultValue(GetUnitType(Context, Units)) };
-
-      Val = ConstantStruct::getAnon(PaddedElt);
-    }
-
-    // Get the index position of the element within the array.  Note that this
-    // can be NULL_TREE, which means that it belongs in the next available slot.
-    tree index = elt_index;
+    Constant *Val = ConvertArrayElement(elt_value, elt_type, EltSize, Folder);
 
     // The first and last elements to fill in, inclusive.
     unsigned FirstIndex, LastIndex;
-    if (!index) {
-      LastIndex = FirstIndex = NextIndex;
-    } else if (isa<RANGE_EXPR>(index)) {
-      tree first = TREE_OPERAND(index, 0);
-      tree last = TREE_OPERAND(index, 1);
-
-      // Subtract off the lower bound if any to ensure indices start from zero.
-      if (lower_bnd != NULL_TREE) {
-        first = fold_build2(MINUS_EXPR, main_type(first), first, lower_bnd);
-        last = fold_build2(MINUS_EXPR, main_type(last), last, lower_bnd);
-      }
-
-      assert(host_integerp(first, 1) && host_integerp(last, 1) &&
-             "Unknown range_expr!");
-//Below condition added by Arun
-#if (GCC_MINOR <= 8)
-//End of lines added by Arun
-      FirstIndex = tree_low_cst(first, 1);
-      LastIndex = tree_low_cst(last, 1);
-//Below lines added by Arun in attempt to compile using gcc 4.9
-#else
-      FirstIndex = tree_to_uhwi(first);
-      LastIndex = tree_to_uhwi(last);
-#endif
-//End of lines added by Arun
-    } else {
-      // Subtract off the lower bound if any to ensure indices start from zero.
-      if (lower_bnd != NULL_TREE)
-        index = fold_build2(MINUS_EXPR, main_type(index), index, lower_bnd);
-      assert(host_integerp(index, 1));
-//Below condition added by Arun
-#if (GCC_MINOR <= 8)
-//End of lines added by Arun
-      FirstIndex = tree_low_cst(index, 1);
-//Below lines added by Arun in attempt to compile using gcc 4.9
-#else
-      FirstIndex = tree_to_uhwi(index);
-#endif
-//End of lines added by Arun
-      LastIndex = FirstIndex;
-    }
+    GetElementRange(elt_index, lower_bnd, NextIndex, FirstIndex, LastIndex);
 
     // Process all of the elements in the range.
     if (LastIndex >= Elts.size())
@@ -1004,6 +1276,40 @@ static Constant *ConvertArrayCONSTRUCTOR(tree exp, TargetFolder &Folder) {
   return ConstantArray::get(ArrayType::get(ActualEltTy, Elts.size()), Elts);
 }
 
+/// TruncateAggregate - Return the leading part of the struct or array constant
+/// C as a constant of type Prefix, which must be as given by GetAggregatePrefix
+/// for the type of C.  Elements that are kept are used as is.
+static Constant *TruncateAggregate(Constant *C, StructType *Prefix,
+                                   TargetFolder &Folder) {
+  const DataLayout &DL = getDataLayout();
+  const StructLayout *SL = DL.getStructLayout(Prefix);
+  std::vector<Constant *> Vals;
+  for (unsigned i = 0, e = Prefix->getNumElements(); i != e; ++i) {
+    Type *EltTy = Prefix->getElementType(i);
+    uint64_t Offset = SL->getElementOffset(i);
+    Constant *Val = 0;
+    if (StructType *STy = dyn_cast<StructType>(C->getType())) {
+      const StructLayout *CL = DL.getStructLayout(STy);
+      unsigned Idx = CL->getElementContainingOffset(Offset);
+      if (CL->getElementOffset(Idx) == Offset &&
+          STy->getElementType(Idx) == EltTy)
+        Val = Folder.CreateExtractValue(C, Idx);
+    } else if (Offset == 0 && EltTy->isArrayTy() &&
+               EltTy->getArrayElementType() ==
+               C->getType()->getArrayElementType()) {
+      std::vector<Constant *> ArrayElts;
+      for (unsigned j = 0, f = EltTy->getArrayNumElements(); j != f; ++j)
+        ArrayElts.push_back(Folder.CreateExtractValue(C, j));
+      Val = ConstantArray::get(cast<ArrayType>(EltTy), ArrayElts);
+    }
+    // Padding, or anything else, is taken from the bits of the constant.
+    if (!Val)
+      Val = InterpretAsType(C, EltTy, Offset * 8, Folder);
+    Vals.push_back(Val);
+  }
+  return ConstantStruct::get(Prefix, Vals);
+}
+
 /// FieldContents - A constant restricted to a range of bits.  Any part of the
 /// constant outside of the range is discarded.  The range may be bigger than
 /// the constant in which case any extra bits have an undefined value.
@@ -1052,6 +1358,31 @@ class FieldContents {
     return AllocBits <= (unsigned) R.getWidth();
   }
 
+  /// getAsAPInt - If the bits in the range are known integer values, return
+  /// true and set Bits to them, laid out like getAsBits.  Only supported on
+  /// little-endian machines.
+  bool getAsAPInt(APInt &Bits) const {
+    if (BYTES_BIG_ENDIAN || R.empty())
+      return false;
+    unsigned Width = (unsigned) R.getWidth();
+    if (C->isNullValue()) {
+      Bits = APInt(Width, 0);
+      return true;
+    }
+    ConstantInt *CI = dyn_cast<ConstantInt>(C);
+    if (!CI)
+      return false;
+    // Bit i of the result is bit i + Offset of the constant, or zero if there
+    // is no such bit.
+    int Offset = R.getFirst() - Starts;
+    unsigned Shift = (unsigned)(Offset < 0 ? -Offset : Offset);
+    Bits = CI->getValue().zextOrTrunc(
+        std::max(CI->getBitWidth(), Width) + Shift);
+    Bits = Offset < 0 ? Bits.shl(Shift) : Bits.lshr(Shift);
+    Bits = Bits.zextOrTrunc(Width);
+    return true;
+  }
+
 public:
   /// get - Fill the range [first, last) with the given constant.
   static FieldContents
@@ -1110,12 +1441,18 @@ public:
       if (isSafeToReturnContentsDirectly(DL))
         return C;
     }
+    // If the contents are a struct or array that only needs to be truncated
+    // then keep the leading elements, giving the same type as for the field in
+    // the converted record type.
+    unsigned Units = R.getWidth() / BITS_PER_UNIT;
+    if (R.getFirst() == Starts)
+      if (StructType *Prefix = GetAggregatePrefix(C->getType(), Units, DL)) {
+        C = TruncateAggregate(C, Prefix, Folder);
+        assert(isSafeToReturnContentsDirectly(DL) && "Prefix too big!");
+        return C;
+      }
     // Turn the contents into a bunch of bytes.  Remember the returned value as
     // an optimization in case we are called again.
-    // TODO: If the contents only need to be truncated and have struct or array
-    // type then we could try to do the truncation by dropping or modifying the
-    // last elements of the constant, maybe yielding something less horrible.
-    unsigned Units = R.getWidth() / BITS_PER_UNIT;
     C = InterpretAsType(C, GetUnitType(Context, Units), R.getFirst() - Starts,
                         Folder);
     Starts = R.getFirst();
@@ -1136,6 +1473,20 @@ void FieldContents::JoinWith(const FieldContents &S) {
     *this = S;
     return;
   }
+  // If both fields hold plain integers, which is usual for bitfields, paste
+  // the bits together directly rather than building up shifts and ors.
+  APInt Bits, OtherBits;
+  if (getAsAPInt(Bits) && S.getAsAPInt(OtherBits)) {
+    SignedRange Hull = R.Join(S.R);
+    unsigned Width = (unsigned) Hull.getWidth();
+    Bits = Bits.zext(Width).shl((unsigned)(R.getFirst() - Hull.getFirst()));
+    Bits |= OtherBits.zext(Width)
+        .shl((unsigned)(S.R.getFirst() - Hull.getFirst()));
+    R = Hull;
+    C = ConstantInt::get(Context, Bits);
+    Starts = R.getFirst();
+    return;
+  }
   // Consider the contents of the fields to be bunches of bits and paste them
   // together.  This can result in a nasty integer constant expression, but as
   // we only get here for bitfields that's mostly harmless.
@@ -1155,6 +1506,10 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
   Type *Ty = ConvertType(type);
   uint64_t TypeSize = DL.getTypeAllocSizeInBits(Ty);
 
+  // The contents of the fields, in the order they should be added to Layout:
+  // where fields overlap, later contents replace earlier ones.
+  SmallVector<FieldContents, 16> Contents;
+
   // Ensure that fields without an initial value are default initialized by
   // explicitly setting the starting value for all fields to be zero.  If an
   // initial value is supplied for a field then the value will overwrite and
@@ -1207,7 +1562,7 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
       // it is guaranteed to cover all parts of the GCC type that can be default
       // initialized.  This makes for nicer IR than just using a bunch of bytes.
       Constant *Zero = Constant::getNullValue(FieldTy);
-      Layout.AddInterval(FieldContents::get(FirstBit, LastBit, Zero, Folder));
+      Contents.push_back(FieldContents::get(FirstBit, LastBit, Zero, Folder));
     }
   }
 
@@ -1245,8 +1600,9 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
     uint64_t LastBit = FirstBit + BitWidth;
 
     // Set the bits occupied by the field to the initial value.
-    Layout.AddInterval(FieldContents::get(FirstBit, LastBit, Init, Folder));
+    Contents.push_back(FieldContents::get(FirstBit, LastBit, Init, Folder));
   }
+  Layout.AddIntervals(Contents.begin(), Contents.end());
 
   // Force all fields to begin and end on a byte boundary.  This automagically
   // takes care of bitfields.
@@ -1274,6 +1630,7 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
   std::vector<Constant *> Elts;
   Elts.reserve(Layout.getNumIntervals());
   unsigned EndOfPrevious = 0; // Offset of first bit after previous element.
+  unsigned MaxEltAlign = 1;   // The maximum alignment of the elements.
   for (unsigned i = 0, e = Layout.getNumIntervals(); i != e; ++i) {
     FieldContents F = Layout.getInterval(i);
     unsigned First = F.getRange().getFirst();
@@ -1305,11 +1662,16 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
     // Append the field.
     Elts.push_back(Val);
     EndOfPrevious = First + DL.getTypeAllocSizeInBits(Val->getType());
+    MaxEltAlign = std::max(MaxEltAlign, DL.getABITypeAlignment(Val->getType()));
   }
 
   // We guarantee that initializers are always at least as big as the LLVM type
-  // for the initializer.  If needed, append padding to ensure this.
-  if (EndOfPrevious < TypeSize) {
+  // for the initializer.  If needed, append padding to ensure this.  Like for
+  // the type, there is no need if the tail padding of an ordinary struct makes
+  // up the difference.
+  uint64_t NaturalEnd =
+      Pack ? EndOfPrevious : RoundUpToAlignment(EndOfPrevious, MaxEltAlign * 8);
+  if (EndOfPrevious < TypeSize && NaturalEnd != TypeSize) {
     assert((TypeSize - EndOfPrevious) % BITS_PER_UNIT == 0 &&
            "Non-unit type size?");
     unsigned Units = (TypeSize - EndOfPrevious) / BITS_PER_UNIT;
@@ -1334,6 +1696,14 @@ static Constant *ConvertRecordCONSTRUCTOR(tree exp, TargetFolder &Folder) {
           Elts[i] = Folder.CreateBitCast(Elts[i], FieldTy);
           continue;
         }
+        // If the element occupies the same bytes as the field, as for example
+        // when the field is bytes standing in for a truncated aggregate, then
+        // reinterpret it rather than losing the named type.
+        if (DL.getTypeAllocSize(EltTy) == DL.getTypeAllocSize(FieldTy) &&
+            DL.getABITypeAlignment(EltTy) == DL.getABITypeAlignment(FieldTy)) {
+          Elts[i] = InterpretAsType(Elts[i], FieldTy, 0, Folder);
+          continue;
+        }
         // Too hard, just give up.
         EltTypesMatch = false;
         break;
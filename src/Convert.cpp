@@ -28,10 +28,13 @@
 #include "dragonegg/TypeConversion.h"
 
 // LLVM headers
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetLowering.h"
@@ -102,6 +105,8 @@ extern "C" {
 #include "stmt.h"
 #include "gimple.h"
 #include "gimple-iterator.h"
+#include "gimple-ssa.h"
+#include "tree-ssanames.h"
 
 //Below line was in gimple.h
 extern bool validate_gimple_arglist (const_gimple, ...);
@@ -143,6 +148,9 @@ static LLVMContext &Context = getGlobalContext();
 #define DEBUG_TYPE "dragonegg"
 STATISTIC(NumBasicBlocks, "Number of basic blocks converted");
 STATISTIC(NumStatements, "Number of gimple statements converted");
+STATISTIC(NumCallPlansReused, "Number of calls lowered using a cached plan");
+STATISTIC(NumBitfieldStoresMerged,
+          "Number of bitfield stores merged with an earlier one");
 
 /// getPointerAlignment - Return the alignment in bytes of exp, a pointer valued
 /// expression, or 1 if the alignment is not known.
@@ -443,8 +451,10 @@ static Value *LoadRegisterFromMemory(MemRef Loc, tree type, MDNode *AliasTag,
   Type *RegTy = getRegType(type);
 
   // If loading the register type directly out of memory gives the right result,
-  // then just do that.
-  if (isDirectMemoryAccessSafe(RegTy, type)) {
+  // then just do that.  Complex numbers are always loaded part by part though:
+  // a pair of loads from adjacent addresses can be vectorized, while a load of
+  // a first class aggregate cannot.
+  if (!isa<COMPLEX_TYPE>(type) && isDirectMemoryAccessSafe(RegTy, type)) {
     LoadInst *LI = LoadFromLocation(Loc, RegTy, AliasTag, Builder);
     MDNode *Range = describeTypeRange(type);
     if (Range)
@@ -531,8 +541,9 @@ static void StoreRegisterToMemory(Value *V, MemRef Loc, tree type,
   assert(V->getType() == getRegType(type) && "Not of register type!");
 
   // If storing the register directly to memory gives the right result, then
-  // just do that.
-  if (isDirectMemoryAccessSafe(V->getType(), type)) {
+  // just do that.  As when loading, complex numbers are stored part by part.
+  if (!isa<COMPLEX_TYPE>(type) &&
+      isDirectMemoryAccessSafe(V->getType(), type)) {
     StoreToLocation(V, Loc, AliasTag, Builder);
     return;
   }
@@ -630,18 +641,10 @@ TreeToLLVM::TreeToLLVM(tree fndecl)
   Fn = 0;
   ReturnBB = 0;
   ReturnOffset = 0;
+  ContinuedBlock = 0;
 
-  if (EmitDebugInfo()) {
-    expanded_location Location = expand_location(DECL_SOURCE_LOCATION(fndecl));
-
-    if (Location.file) {
-      TheDebugInfo->setLocationFile(Location.file);
-      TheDebugInfo->setLocationLine(Location.line);
-    } else {
-      TheDebugInfo->setLocationFile("");
-      TheDebugInfo->setLocationLine(0);
-    }
-  }
+  if (EmitDebugInfo())
+    TheDebugInfo->setLocation(DECL_SOURCE_LOCATION(fndecl));
 
   assert(TheTreeToLLVM == 0 && "Reentering function creation?");
   TheTreeToLLVM = this;
@@ -858,6 +861,30 @@ struct FunctionPrologArgumentConversion : public DefaultABIClient {
     ++AI;
   }
 
+  void HandleByInvisibleReferenceArgument(llvm::Type */*PtrTy*/, tree type) {
+    // If the argument itself provides the l-value then there is nothing to do.
+    // Otherwise the target chose to pass this aggregate by reference (AArch64
+    // does this for large structs); copy it into the local.
+    if (!LocStack.empty()) {
+      Value *Loc = LocStack.back();
+      Type *SBP = Type::getInt8PtrTy(Context);
+      Type *IntPtr = getDataLayout().getIntPtrType(Context, 0);
+      Value *Ops[5] = {
+        Builder.CreateCast(Instruction::BitCast, Loc, SBP),
+        Builder.CreateCast(Instruction::BitCast, AI, SBP),
+        ConstantInt::get(IntPtr, TREE_INT_CST_LOW(TYPE_SIZE_UNIT(type))),
+        Builder.getInt32(TYPE_ALIGN_UNIT(type)), Builder.getFalse()
+      };
+      Type *ArgTypes[3] = { SBP, SBP, IntPtr };
+      Builder.CreateCall(
+          Intrinsic::getDeclaration(TheModule, Intrinsic::memcpy, ArgTypes),
+          Ops);
+
+      AI->setName(NameStack.back());
+    }
+    ++AI;
+  }
+
   void HandleByValArgument(llvm::Type */*LLVMTy*/, tree type) {
     if (LLVM_BYVAL_ALIGNMENT_TOO_SMALL(type)) {
       // Incoming object on stack is insufficiently aligned for the type.
@@ -1030,7 +1057,7 @@ void TreeToLLVM::StartFunctionBody() {
   TARGET_ADJUST_LLVM_LINKAGE(Fn, FnDecl);
 #endif /* TARGET_ADJUST_LLVM_LINKAGE */
 
-  Fn->setUnnamedAddr(!TREE_ADDRESSABLE(FnDecl));
+  Fn->setUnnamedAddr(!isFunctionAddressTaken(FnDecl));
 
   // Handle visibility style
   handleVisibility(FnDecl, Fn);
@@ -1107,10 +1134,20 @@ void TreeToLLVM::StartFunctionBody() {
   if (flag_unwind_tables)
     Fn->setHasUWTable();
 
+  // Size the per-function maps up front.  They still grow if need be.
+#if (GCC_MINOR < 9)
+  BasicBlocks.resize(last_basic_block);
+#else
+  BasicBlocks.resize(last_basic_block_for_fn(cfun));
+#endif
+  SSANames.resize(num_ssa_names);
+
   // Create a new basic block for the function.
   BasicBlock *EntryBlock = BasicBlock::Create(Context, "entry", Fn);
-  BasicBlocks[ENTRY_BLOCK_PTR_FOR_FN(cfun)] = EntryBlock;
+  getBasicBlockSlot(ENTRY_BLOCK_PTR_FOR_FN(cfun)) = EntryBlock;
   Builder.SetInsertPoint(EntryBlock);
+  ContinuedBlock = ENTRY_BLOCK_PTR_FOR_FN(cfun);
+  BlockOwners[EntryBlock] = ContinuedBlock;
 
   if (EmitDebugInfo())
     TheDebugInfo->EmitFunctionStart(FnDecl, Fn);
@@ -1229,79 +1266,89 @@ void TreeToLLVM::EmitVariablesInScope(tree scope) {
     EmitVariablesInScope(t);
 }
 
+/// getSSANameSlot - Returns the entry of SSANames for the given SSA name,
+/// growing the table if need be.
+AssertingVH<Value> &TreeToLLVM::getSSANameSlot(tree reg) {
+  assert(isa<SSA_NAME>(reg) && "Not an SSA name!");
+  unsigned Version = SSA_NAME_VERSION(reg);
+  if (Version >= SSANames.size())
+    SSANames.resize(Version + 1);
+  return SSANames[Version];
+}
+
 /// DefineSSAName - Use the given value as the definition of the given SSA name.
 /// Returns the provided value as a convenience.
 Value *TreeToLLVM::DefineSSAName(tree reg, Value *Val) {
-  assert(isa<SSA_NAME>(reg) && "Not an SSA name!");
-  if (Value *ExistingValue = SSANames[reg]) {
-    if (Val != ExistingValue) {
-      assert(isSSAPlaceholder(ExistingValue) && "Multiply defined SSA name!");
-      // Replace the placeholder with the value everywhere.  This also updates
-      // the map entry, because it is a TrackingVH.
-      ExistingValue->replaceAllUsesWith(Val);
-      delete ExistingValue;
-    }
+  AssertingVH<Value> &Slot = getSSANameSlot(reg);
+  Value *ExistingValue = Slot;
+  if (ExistingValue == Val)
     return Val;
+  Slot = Val;
+
+  if (ExistingValue) {
+    assert(isSSAPlaceholder(ExistingValue) && "Multiply defined SSA name!");
+    // Replace the placeholder with the value everywhere, including in the map
+    // entries of any SSA names that were defined to be the placeholder.
+    for (unsigned i = 0, e = PlaceholderCopies.size(); i != e; ++i) {
+      AssertingVH<Value> &CopySlot = getSSANameSlot(PlaceholderCopies[i]);
+      if (CopySlot == ExistingValue)
+        CopySlot = Val;
+    }
+    ExistingValue->replaceAllUsesWith(Val);
+    delete ExistingValue;
   }
-  return SSANames[reg] = Val;
-}
 
-typedef SmallVector<std::pair<BasicBlock *, unsigned>, 8> PredVector;
-typedef SmallVector<std::pair<BasicBlock *, tree>, 8> TreeVector;
-typedef SmallVector<std::pair<BasicBlock *, Value *>, 8> ValueVector;
+  // If this SSA name is a copy of one that has not been defined yet, remember
+  // it so that its map entry can be updated when the definition turns up.
+  if (isSSAPlaceholder(Val))
+    PlaceholderCopies.push_back(reg);
+  return Val;
+}
 
 /// PopulatePhiNodes - Populate generated phi nodes with their operands.
 void TreeToLLVM::PopulatePhiNodes() {
-  PredVector Predecessors;
-  TreeVector IncomingValues;
-  ValueVector PhiArguments;
+  // The incoming GCC expression for each GCC basic block, indexed by the basic
+  // block index.  Only the entries for the phi being processed are non-null.
+  std::vector<tree> IncomingValues(BasicBlocks.size());
+
+  // Information about the LLVM basic block containing the phi nodes, computed
+  // once and shared by all the phi nodes in the block: its predecessors in the
+  // order given by the predecessor list; the GCC basic block each predecessor
+  // was output for; and, since in LLVM a predecessor can occur several times,
+  // the position of the first occurrence of each predecessor.
+  BasicBlock *PhiBB = 0;
+  SmallVector<BasicBlock *, 8> Predecessors;
+  SmallVector<basic_block, 8> PredOwners;
+  SmallVector<unsigned, 8> FirstOccurrence;
+  DenseMap<BasicBlock *, unsigned> PredPositions;
+
+  // The phi operand for each predecessor, in the same order.
+  SmallVector<Value *, 8> PhiArguments;
 
   for (unsigned Idx = 0, EIdx = (unsigned) PendingPhis.size(); Idx < EIdx;
        ++Idx) {
     // The phi node to process.
     PhiRecord &P = PendingPhis[Idx];
 
-    // Extract the incoming value for each predecessor from the GCC phi node.
-    for (unsigned i = 0, e = gimple_phi_num_args(P.gcc_phi); i != e; ++i) {
-      // The incoming GCC basic block.
-      basic_block bb = gimple_phi_arg_edge(P.gcc_phi, i)->src;
-
-      // The corresponding LLVM basic block.
-      DenseMap<basic_block, BasicBlock *>::iterator BI = BasicBlocks.find(bb);
-      assert(BI != BasicBlocks.end() && "GCC basic block not output?");
-
-      // The incoming GCC expression.
-      tree val = gimple_phi_arg(P.gcc_phi, i)->def;
-
-      // Associate it with the LLVM basic block.
-      IncomingValues.push_back(std::make_pair(BI->second, val));
-
-      // Several LLVM basic blocks may be generated when emitting one GCC basic
-      // block.  The additional blocks always occur immediately after the main
-      // basic block, and can be identified by the fact that they are nameless.
-      // Associate the incoming expression with all of them, since any of them
-      // may occur as a predecessor of the LLVM basic block containing the phi.
-      Function::iterator FI(BI->second), FE = Fn->end();
-      for (++FI; FI != FE && !FI->hasName(); ++FI) {
-        assert(FI->getSinglePredecessor() == IncomingValues.back().first &&
-               "Anonymous block does not continue predecessor!");
-        IncomingValues.push_back(std::make_pair(FI, val));
+    // Phi nodes for the same basic block are output together, so only compute
+    // the predecessor information when moving on to a new block.
+    if (P.PHI->getParent() != PhiBB) {
+      PhiBB = P.PHI->getParent();
+      Predecessors.clear();
+      PredOwners.clear();
+      FirstOccurrence.clear();
+      PredPositions.clear();
+      for (pred_iterator PI = pred_begin(PhiBB), PE = pred_end(PhiBB); PI != PE;
+           ++PI) {
+        BasicBlock *Pred = *PI;
+        unsigned Position = (unsigned) Predecessors.size();
+        Predecessors.push_back(Pred);
+        PredOwners.push_back(BlockOwners.lookup(Pred));
+        FirstOccurrence.push_back(
+            PredPositions.insert(std::make_pair(Pred, Position)).first->second);
       }
     }
 
-    // Sort the incoming values by basic block to help speed up queries.
-    std::sort(IncomingValues.begin(), IncomingValues.end());
-
-    // Get the LLVM predecessors for the basic block containing the phi node,
-    // and remember their positions in the list of predecessors (this is used
-    // to avoid adding phi operands in a non-deterministic order).
-    Predecessors.reserve(gimple_phi_num_args(P.gcc_phi)); // At least this many.
-    BasicBlock *PhiBB = P.PHI->getParent();
-    unsigned Index = 0;
-    for (pred_iterator PI = pred_begin(PhiBB), PE = pred_end(PhiBB); PI != PE;
-         ++PI, ++Index)
-      Predecessors.push_back(std::make_pair(*PI, Index));
-
     if (Predecessors.empty()) {
       // FIXME: If this happens then GCC has a control flow edge where LLVM has
       // none - something has gone wrong.  For the moment be laid back about it
@@ -1309,54 +1356,49 @@ void TreeToLLVM::PopulatePhiNodes() {
       // happens all the time in Ada and C++.
       P.PHI->replaceAllUsesWith(UndefValue::get(P.PHI->getType()));
       P.PHI->eraseFromParent();
-      IncomingValues.clear();
       continue;
     }
 
-    // Sort the predecessors by basic block.  In GCC, each predecessor occurs
-    // exactly once.  However in LLVM a predecessor can occur several times,
-    // and then every copy of the predecessor must be associated with exactly
-    // the same incoming value in the phi node.  Sorting the predecessors groups
-    // multiple occurrences together, making this easy to handle.
-    std::sort(Predecessors.begin(), Predecessors.end());
+    // Extract the incoming value for each predecessor from the GCC phi node.
+    unsigned NumArgs = gimple_phi_num_args(P.gcc_phi);
+    for (unsigned i = 0; i != NumArgs; ++i) {
+      // The incoming GCC basic block.
+      basic_block bb = gimple_phi_arg_edge(P.gcc_phi, i)->src;
+      assert(getBasicBlockSlot(bb) && "GCC basic block not output?");
+      IncomingValues[bb->index] = gimple_phi_arg(P.gcc_phi, i)->def;
+    }
 
-    // Now iterate over the predecessors, setting phi operands as we go.
-    TreeVector::iterator VI = IncomingValues.begin(), VE = IncomingValues.end();
-    PredVector::iterator PI = Predecessors.begin(), PE = Predecessors.end();
-    PhiArguments.resize((unsigned) Predecessors.size());
-    while (PI != PE) {
-      // The predecessor basic block.
-      BasicBlock *BB = PI->first;
+    // Now iterate over the predecessors, working out the phi operands.  Every
+    // occurrence of a predecessor gets the same operand.
+    PhiArguments.resize(Predecessors.size());
+    for (unsigned i = 0, e = Predecessors.size(); i != e; ++i) {
+      if (FirstOccurrence[i] != i) {
+        PhiArguments[i] = PhiArguments[FirstOccurrence[i]];
+        continue;
+      }
 
-      // Find the incoming value for this predecessor.
-      while (VI != VE && VI->first != BB)
-        ++VI;
-      assert(VI != VE && "No value for predecessor!");
-      Value *Val = EmitRegister(VI->second);
+      // The predecessor basic block, which may be one of several LLVM basic
+      // blocks generated when emitting the GCC basic block.
+      BasicBlock *BB = Predecessors[i];
+      basic_block bb = PredOwners[i];
+      assert(bb && IncomingValues[bb->index] && "No value for predecessor!");
+      Value *Val = EmitRegister(IncomingValues[bb->index]);
 
       // Need to bitcast to the right type (useless_type_conversion_p).  Place
       // the bitcast at the end of the predecessor, before the terminator.
       if (Val->getType() != P.PHI->getType())
         Val = new BitCastInst(Val, P.PHI->getType(), "", BB->getTerminator());
 
-      // Add the phi node arguments for all occurrences of this predecessor.
-      do {
-        // Place the argument at the position given by PI->second, which is the
-        // original position before sorting of the predecessor in the pred list.
-        // Since the predecessors were sorted non-deterministically (by pointer
-        // value), this ensures that the same bitcode is produced on any run.
-        PhiArguments[PI++->second] = std::make_pair(BB, Val);
-      } while (PI != PE && PI->first == BB);
+      PhiArguments[i] = Val;
     }
 
-    // Add the operands to the phi node.
-    for (ValueVector::iterator I = PhiArguments.begin(), E = PhiArguments.end();
-         I != E; ++I)
-      P.PHI->addIncoming(I->second, I->first);
+    // Add the operands to the phi node, in the order of the predecessor list so
+    // that the same bitcode is produced on any run.
+    for (unsigned i = 0, e = Predecessors.size(); i != e; ++i)
+      P.PHI->addIncoming(PhiArguments[i], Predecessors[i]);
 
-    IncomingValues.clear();
-    PhiArguments.clear();
-    Predecessors.clear();
+    for (unsigned i = 0; i != NumArgs; ++i)
+      IncomingValues[gimple_phi_arg_edge(P.gcc_phi, i)->src->index] = 0;
   }
 
   PendingPhis.clear();
@@ -1458,6 +1500,7 @@ Function *TreeToLLVM::FinishFunctionBody() {
       if (CurBB->getName().empty() && CurBB->begin() == CurBB->end()) {
         // If the previous block has no label and is empty, remove it: it is a
         // post-terminator block.
+        BlockOwners.erase(CurBB);
         CurBB->eraseFromParent();
         Builder.SetInsertPoint(&Fn->getBasicBlockList().back());
       } else {
@@ -1476,6 +1519,9 @@ Function *TreeToLLVM::FinishFunctionBody() {
   EmitLandingPads();
   EmitFailureBlocks();
 
+  // With all code output, work out where clobbered variables come to life.
+  EmitLifetimeStarts();
+
   if (ReturnBB) {
     // FIXME: This should be output just before the return call generated above.
     // But because EmitFunctionEnd pops the region stack, that means that if the
@@ -1497,23 +1543,25 @@ Function *TreeToLLVM::FinishFunctionBody() {
 #else
 // When checks are enabled, complain if an SSA name was used but not defined.
 #endif
-    for (DenseMap<tree, TrackingVH<Value> >::const_iterator
-             I = SSANames.begin(),
-             E = SSANames.end();
-         I != E; ++I) {
-      Value *NameDef = I->second;
+    for (unsigned Version = 0, E = SSANames.size(); Version != E; ++Version) {
+      Value *NameDef = SSANames[Version];
       // If this is not a placeholder then the SSA name was defined.
-      if (!isSSAPlaceholder(NameDef))
+      if (!NameDef || !isSSAPlaceholder(NameDef))
         continue;
 
       // If an error occurred then replace the placeholder with undef.  Thanks
       // to this we can just bail out on errors, without having to worry about
       // whether we defined every SSA name.
       if (errorcount || sorrycount) {
-        NameDef->replaceAllUsesWith(UndefValue::get(NameDef->getType()));
+        Value *Undef = UndefValue::get(NameDef->getType());
+        // Later SSA names may have been defined to be this placeholder too.
+        for (unsigned i = Version; i != E; ++i)
+          if (SSANames[i] == NameDef)
+            SSANames[i] = Undef;
+        NameDef->replaceAllUsesWith(Undef);
         delete NameDef;
       } else {
-        debug_tree(I->first);
+        debug_tree(ssa_name(Version));
         llvm_unreachable("SSA name never defined!");
       }
     }
@@ -1521,12 +1569,173 @@ Function *TreeToLLVM::FinishFunctionBody() {
   return Fn;
 }
 
+/// EmitLifetimeStarts - Output llvm.lifetime.start intrinsics for the local
+/// variables that were clobbered, which is how GCC marks the end of a scope.
+/// Like GCC when it shares stack slots between variables, consider a variable
+/// to be live from any use of it until it is clobbered.  A lifetime start is
+/// output before every use at which the variable is dead on all paths.  If at
+/// some use the variable is live on some paths but dead on others, or if its
+/// address is passed through a phi node, then no lifetime start is output for
+/// it at all.
+void TreeToLLVM::EmitLifetimeStarts() {
+  if (ClobberedLocals.empty())
+    return;
+
+  // Number the variables.
+  DenseMap<AllocaInst *, unsigned> VarNums;
+  SmallVector<AllocaInst *, 8> Vars;
+  for (unsigned i = 0, e = ClobberedLocals.size(); i != e; ++i)
+    if (VarNums.insert(std::make_pair(ClobberedLocals[i], Vars.size())).second)
+      Vars.push_back(ClobberedLocals[i]);
+  unsigned NumVars = Vars.size();
+
+  // Find the instructions that use each variable, other than to compute an
+  // address, and the lifetime ends.  Each event is a variable together with
+  // whether the event is a lifetime end.
+  typedef std::pair<unsigned, bool> VarEvent;
+  DenseMap<Instruction *, SmallVector<VarEvent, 2> > Events;
+  BitVector Unsafe(NumVars);
+  SmallVector<std::pair<Value *, unsigned>, 16> Worklist;
+  for (unsigned i = 0; i != NumVars; ++i)
+    Worklist.push_back(std::make_pair(Vars[i], i));
+  while (!Worklist.empty()) {
+    Value *Ptr = Worklist.back().first;
+    unsigned Var = Worklist.back().second;
+    Worklist.pop_back();
+    for (Value::user_iterator I = Ptr->user_begin(), E = Ptr->user_end();
+         I != E; ++I) {
+      Instruction *User = cast<Instruction>(*I);
+      if (isa<BitCastInst>(User) || isa<GetElementPtrInst>(User))
+        Worklist.push_back(std::make_pair(User, Var));
+      else if (isa<PHINode>(User) || isa<SelectInst>(User))
+        Unsafe.set(Var);
+      else if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(User))
+        Events[User].push_back(
+            VarEvent(Var, II->getIntrinsicID() == Intrinsic::lifetime_end));
+      else
+        Events[User].push_back(VarEvent(Var, false));
+    }
+  }
+
+  // For each basic block, the variables whose last event in the block is a use
+  // (Used) or a lifetime end (Ended).
+  DenseMap<BasicBlock *, unsigned> BlockNums;
+  std::vector<BitVector> Used, Ended;
+  for (Function::iterator BB = Fn->begin(), E = Fn->end(); BB != E; ++BB) {
+    BlockNums[BB] = Used.size();
+    Used.push_back(BitVector(NumVars));
+    Ended.push_back(BitVector(NumVars));
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      DenseMap<Instruction *, SmallVector<VarEvent, 2> >::iterator EI =
+          Events.find(I);
+      if (EI == Events.end())
+        continue;
+      for (unsigned i = 0, e = EI->second.size(); i != e; ++i) {
+        unsigned Var = EI->second[i].first;
+        bool isEnd = EI->second[i].second;
+        Used.back()[Var] = !isEnd;
+        Ended.back()[Var] = isEnd;
+      }
+    }
+  }
+
+  // Work out which variables may be live (MayLive) and which may be dead
+  // (MayDead) on entry to each basic block.  Every variable is dead on entry
+  // to the function.
+  unsigned NumBlocks = Used.size();
+  std::vector<BitVector> MayLive(NumBlocks, BitVector(NumVars));
+  std::vector<BitVector> MayDead(NumBlocks, BitVector(NumVars));
+  MayDead[0].set();
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (Function::iterator BB = Fn->begin(), E = Fn->end(); BB != E; ++BB) {
+      unsigned BBNum = BlockNums[BB];
+      BitVector Touched = Used[BBNum];
+      Touched |= Ended[BBNum];
+      BitVector LiveOut = MayLive[BBNum];
+      LiveOut.reset(Touched);
+      LiveOut |= Used[BBNum];
+      BitVector DeadOut = MayDead[BBNum];
+      DeadOut.reset(Touched);
+      DeadOut |= Ended[BBNum];
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        unsigned SuccNum = BlockNums[*SI];
+        BitVector NewLive = MayLive[SuccNum];
+        NewLive |= LiveOut;
+        BitVector NewDead = MayDead[SuccNum];
+        NewDead |= DeadOut;
+        if (NewLive != MayLive[SuccNum] || NewDead != MayDead[SuccNum]) {
+          MayLive[SuccNum] = NewLive;
+          MayDead[SuccNum] = NewDead;
+          Changed = true;
+        }
+      }
+    }
+  }
+
+  // Find the uses at which a variable is certainly dead.
+  SmallVector<std::pair<Instruction *, unsigned>, 16> Starts;
+  for (Function::iterator BB = Fn->begin(), E = Fn->end(); BB != E; ++BB) {
+    unsigned BBNum = BlockNums[BB];
+    BitVector Live = MayLive[BBNum], Dead = MayDead[BBNum];
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      DenseMap<Instruction *, SmallVector<VarEvent, 2> >::iterator EI =
+          Events.find(I);
+      if (EI == Events.end())
+        continue;
+      for (unsigned i = 0, e = EI->second.size(); i != e; ++i) {
+        unsigned Var = EI->second[i].first;
+        if (EI->second[i].second) {
+          Live.reset(Var);
+          Dead.set(Var);
+          continue;
+        }
+        if (Dead[Var] && Live[Var]) {
+          Unsafe.set(Var);
+        } else if (Dead[Var]) {
+          Starts.push_back(std::make_pair(&*I, Var));
+        }
+        Live.set(Var);
+        Dead.reset(Var);
+      }
+    }
+  }
+
+  Function *StartIntr =
+      Intrinsic::getDeclaration(TheModule, Intrinsic::lifetime_start);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  for (unsigned i = 0, e = Starts.size(); i != e; ++i) {
+    unsigned Var = Starts[i].second;
+    if (Unsafe[Var])
+      continue;
+    AllocaInst *AI = Vars[Var];
+    Instruction *InsertPt = Starts[i].first;
+    uint64_t Size = AI->isArrayAllocation()
+                    ? ~0ULL
+                    : DL.getTypeAllocSize(AI->getAllocatedType());
+    Value *Ops[] = { ConstantInt::get(Type::getInt64Ty(Context), Size),
+                     CastInst::CreatePointerCast(AI, Int8PtrTy, "", InsertPt) };
+    CallInst::Create(StartIntr, Ops, "", InsertPt);
+  }
+}
+
+/// getBasicBlockSlot - Returns the entry of BasicBlocks for the given GCC basic
+/// block, growing the table if need be.
+BasicBlock *&TreeToLLVM::getBasicBlockSlot(basic_block bb) {
+  unsigned Index = bb->index;
+  if (Index >= BasicBlocks.size())
+    BasicBlocks.resize(Index + 1);
+  return BasicBlocks[Index];
+}
+
 /// getBasicBlock - Find or create the LLVM basic block corresponding to BB.
 BasicBlock *TreeToLLVM::getBasicBlock(basic_block bb) {
   // If we already associated an LLVM basic block with BB, then return it.
-  DenseMap<basic_block, BasicBlock *>::iterator I = BasicBlocks.find(bb);
-  if (I != BasicBlocks.end())
-    return I->second;
+  BasicBlock *&Slot = getBasicBlockSlot(bb);
+  if (Slot)
+    return Slot;
 
   // Otherwise, create a new LLVM basic block.
   BasicBlock *BB = BasicBlock::Create(Context);
@@ -1556,7 +1765,7 @@ BasicBlock *TreeToLLVM::getBasicBlock(basic_block bb) {
     BB->setName(Index);
   }
 
-  return BasicBlocks[bb] = BB;
+  return Slot = BB;
 }
 
 /// getLabelDeclBlock - Lazily get and create a basic block for the specified
@@ -1577,6 +1786,82 @@ BasicBlock *TreeToLLVM::getLabelDeclBlock(tree LabelDecl) {
   return BB;
 }
 
+/// getMergeableBitfieldStore - If the statement stores a register or constant
+/// to a non-volatile bitfield at a constant offset in a record, return the
+/// bitfield reference being stored to.  Otherwise return null.
+static tree getMergeableBitfieldStore(gimple stmt) {
+  if (gimple_code(stmt) != GIMPLE_ASSIGN ||
+      get_gimple_rhs_class(gimple_expr_code(stmt)) != GIMPLE_SINGLE_RHS)
+    return 0;
+  tree lhs = gimple_assign_lhs(stmt);
+  if (!isa<COMPONENT_REF>(lhs) || TREE_THIS_VOLATILE(lhs) ||
+      TREE_OPERAND(lhs, 2) || !isa<INTEGRAL_TYPE>(TREE_TYPE(lhs)))
+    return 0;
+  tree field = TREE_OPERAND(lhs, 1);
+  if (!isBitfield(field) || !OffsetIsLLVMCompatible(field) ||
+      !isInt64(DECL_SIZE(field), true) ||
+      lookup_attribute("annotate", DECL_ATTRIBUTES(field)))
+    return 0;
+  tree rhs = gimple_assign_rhs1(stmt);
+  if (!isa<SSA_NAME>(rhs) && !isa<INTEGER_CST>(rhs))
+    return 0;
+  return lhs;
+}
+
+/// isRegisterOnlyStatement - Return true if the statement neither accesses
+/// memory nor can trap, so that stores can be moved past it.
+static bool isRegisterOnlyStatement(gimple stmt) {
+  if (gimple_code(stmt) == GIMPLE_DEBUG)
+    return true;
+  return gimple_code(stmt) == GIMPLE_ASSIGN &&
+         isa<SSA_NAME>(gimple_assign_lhs(stmt)) && !gimple_vuse(stmt) &&
+         !gimple_could_trap_p(stmt);
+}
+
+/// getBitfieldStoreGroup - Starting at the given statement, collect the run of
+/// stores to bitfields of the same object that together write a contiguous
+/// range of at most 64 bits.  The stores may be interleaved with statements
+/// that only compute registers, such as the conversions of the stored values,
+/// which are returned in Others.  Returns the number of statements up to and
+/// including the last store.
+static unsigned getBitfieldStoreGroup(gimple_stmt_iterator gsi,
+                                      SmallVectorImpl<gimple> &Stores,
+                                      SmallVectorImpl<gimple> &Others) {
+  tree first = getMergeableBitfieldStore(gsi_stmt(gsi));
+  if (!first)
+    return 0;
+  tree base = TREE_OPERAND(first, 0);
+  uint64_t LoByte = ~0ULL, HiByte = 0;
+  unsigned NumStmts = 0, Length = 0, NumOthers = 0;
+  for (; !gsi_end_p(gsi); gsi_next(&gsi)) {
+    gimple stmt = gsi_stmt(gsi);
+    ++NumStmts;
+    if (isRegisterOnlyStatement(stmt)) {
+      Others.push_back(stmt);
+      continue;
+    }
+    tree lhs = getMergeableBitfieldStore(stmt);
+    if (!lhs || !operand_equal_p(TREE_OPERAND(lhs, 0), base, 0))
+      break;
+    tree field = TREE_OPERAND(lhs, 1);
+    uint64_t FieldStart = getFieldOffsetInBits(field);
+    uint64_t FieldLo = FieldStart / 8;
+    uint64_t FieldHi = (FieldStart + getInt64(DECL_SIZE(field), true) + 7) / 8;
+    // Only merge if no byte outside the fields stored to needs to be touched.
+    if (!Stores.empty() && (FieldHi < LoByte || FieldLo > HiByte ||
+                            std::max(FieldHi, HiByte) -
+                                    std::min(FieldLo, LoByte) > 8))
+      break;
+    LoByte = std::min(FieldLo, LoByte);
+    HiByte = std::max(FieldHi, HiByte);
+    Stores.push_back(stmt);
+    Length = NumStmts;
+    NumOthers = Others.size();
+  }
+  Others.resize(NumOthers);
+  return Length;
+}
+
 void TreeToLLVM::EmitBasicBlock(basic_block bb) {
   location_t saved_loc = input_location;
   ++NumBasicBlocks;
@@ -1585,6 +1870,10 @@ void TreeToLLVM::EmitBasicBlock(basic_block bb) {
   if (bb != ENTRY_BLOCK_PTR_FOR_FN(cfun))
     BeginBlock(getBasicBlock(bb));
 
+  // Any nameless blocks output from here on continue this basic block.
+  ContinuedBlock = bb;
+  BlockOwners[Builder.GetInsertBlock()] = bb;
+
   // Create an LLVM phi node for each GCC phi and define the associated ssa name
   // using it.  Do not populate with operands at this point since some ssa names
   // the phi uses may not have been defined yet - phis are special this way.
@@ -1619,16 +1908,28 @@ void TreeToLLVM::EmitBasicBlock(basic_block bb) {
     ++NumStatements;
 
     if (EmitDebugInfo()) {
-      if (gimple_has_location(stmt)) {
-        TheDebugInfo->setLocationFile(gimple_filename(stmt));
-        TheDebugInfo->setLocationLine(gimple_lineno(stmt));
-      } else {
-        TheDebugInfo->setLocationFile("");
-        TheDebugInfo->setLocationLine(0);
-      }
+      TheDebugInfo->setLocation(gimple_has_location(stmt) ?
+                                gimple_location(stmt) : UNKNOWN_LOCATION);
       TheDebugInfo->EmitStopPoint(Builder.GetInsertBlock(), Builder);
     }
 
+    // Nearby stores to neighbouring bitfields are output as one read-modify-
+    // write of the memory they share, after any register computations mixed
+    // in with them.
+    SmallVector<gimple, 8> Stores, Others;
+    unsigned Length = getBitfieldStoreGroup(gsi, Stores, Others);
+    if (Stores.size() > 1) {
+      for (unsigned i = 0, e = Others.size(); i != e; ++i)
+        if (gimple_code(Others[i]) == GIMPLE_ASSIGN)
+          RenderGIMPLE_ASSIGN(Others[i]);
+      EmitBitfieldStores(Stores);
+      NumStatements += Length - 1;
+      NumBitfieldStoresMerged += Stores.size() - 1;
+      while (--Length)
+        gsi_next(&gsi);
+      continue;
+    }
+
     switch (gimple_code(stmt)) {
     default:
       debug_gimple_stmt(stmt);
@@ -1682,8 +1983,7 @@ void TreeToLLVM::EmitBasicBlock(basic_block bb) {
   }
 
   if (EmitDebugInfo()) {
-    TheDebugInfo->setLocationFile("");
-    TheDebugInfo->setLocationLine(0);
+    TheDebugInfo->setLocation(UNKNOWN_LOCATION);
     TheDebugInfo->EmitStopPoint(Builder.GetInsertBlock(), Builder);
   }
 
@@ -2047,16 +2347,39 @@ void TreeToLLVM::BeginBlock(BasicBlock *BB) {
   if (CurBB->getTerminator() == 0) {
     // If the previous block has no label and is empty, remove it: it is a
     // post-terminator block.
-    if (CurBB->getName().empty() && CurBB->begin() == CurBB->end())
+    if (CurBB->getName().empty() && CurBB->begin() == CurBB->end()) {
+      BlockOwners.erase(CurBB);
       CurBB->eraseFromParent();
-    else
+    } else {
       // Otherwise, fall through to this block.
       Builder.CreateBr(BB);
+    }
   }
 
   // Add this block.
   Fn->getBasicBlockList().push_back(BB);
   Builder.SetInsertPoint(BB); // It is now the current block.
+
+  // Several LLVM basic blocks may be generated when emitting one GCC basic
+  // block.  The additional blocks are nameless, so a nameless block continues
+  // the GCC basic block being output while a named block does not.
+  if (BB->hasName())
+    ContinuedBlock = 0;
+  else if (ContinuedBlock)
+    BlockOwners[BB] = ContinuedBlock;
+}
+
+/// isStackAddress - Return whether the given value is the address of, or an
+/// address inside, a stack object of the function being converted.
+static bool isStackAddress(Value *V) {
+  while (true) {
+    if (isa<AllocaInst>(V))
+      return true;
+    unsigned Opcode = Operator::getOpcode(V);
+    if (Opcode != Instruction::BitCast && Opcode != Instruction::GetElementPtr)
+      return false;
+    V = cast<User>(V)->getOperand(0);
+  }
 }
 
 static const unsigned TooCostly = 8;
@@ -2122,6 +2445,109 @@ static unsigned CostOfAccessingAllElements(tree type) {
   return TooCostly;
 }
 
+/// getChunkSize - Return the widest access, in octets, to use when copying or
+/// zeroing memory with the given alignment inline.  This is the size of the
+/// widest vector register of the target, or a word if it has none.  On strict
+/// alignment targets it is further limited by the alignment.
+static unsigned getChunkSize(unsigned Align) {
+  unsigned Size = getVectorWidth();
+  if (STRICT_ALIGNMENT)
+    Size = std::min(Size, Align);
+  return Size;
+}
+
+/// CountChunks - Return the number of accesses needed to cover Size octets
+/// using pieces of ChunkSize octets, followed by successively halved pieces
+/// for the remainder.
+static uint64_t CountChunks(uint64_t Size, unsigned ChunkSize) {
+  uint64_t NumChunks = Size / ChunkSize;
+  for (unsigned Rest = Size % ChunkSize; Rest; Rest &= Rest - 1)
+    ++NumChunks;
+  return NumChunks;
+}
+
+/// getChunkType - Return the type to use for accessing a piece of memory of
+/// the given size, see getChunkSize.
+static Type *getChunkType(unsigned Bytes, LLVMContext &Context) {
+  if (Bytes <= 8)
+    return IntegerType::get(Context, Bytes * 8);
+  return VectorType::get(Type::getInt8Ty(Context), Bytes);
+}
+
+#ifndef TARGET_DRAGONEGG_MAX_INLINE_CHUNKS
+#define TARGET_DRAGONEGG_MAX_INLINE_CHUNKS 8
+#endif
+
+/// getInlineChunkSize - If an aggregate of the given type should be copied or
+/// zeroed using a short sequence of wide loads and stores rather than a call
+/// to memcpy or memset, return the widest access to use.  Otherwise return 0.
+/// Objects on the stack are left to memcpy or memset, which scalar replacement
+/// of aggregates understands better.
+static unsigned getInlineChunkSize(tree type, const MemRef &DestLoc,
+                                   const MemRef *SrcLoc, unsigned ElementCost) {
+  if (!isInt64(TYPE_SIZE_UNIT(type), true) || DestLoc.Volatile ||
+      isStackAddress(DestLoc.Ptr))
+    return 0;
+  unsigned Align = DestLoc.getAlignment();
+  if (SrcLoc) {
+    if (SrcLoc->Volatile || isStackAddress(SrcLoc->Ptr))
+      return 0;
+    Align = std::min(Align, SrcLoc->getAlignment());
+  }
+  uint64_t Size = getInt64(TYPE_SIZE_UNIT(type), true);
+  unsigned ChunkSize = getChunkSize(Align);
+  uint64_t NumChunks = CountChunks(Size, ChunkSize);
+  // Going element by element is no worse if it takes no more accesses, and it
+  // keeps the types of the elements.
+  if (!NumChunks || NumChunks > TARGET_DRAGONEGG_MAX_INLINE_CHUNKS ||
+      ElementCost <= NumChunks)
+    return 0;
+  return ChunkSize;
+}
+
+/// CopyByChunks - Copy Size octets from SrcLoc to DestLoc using accesses of at
+/// most ChunkSize octets.  Helper for EmitAggregateCopy.
+void TreeToLLVM::CopyByChunks(MemRef DestLoc, MemRef SrcLoc, uint64_t Size,
+                              unsigned ChunkSize) {
+  Type *BytePtrTy = Type::getInt8PtrTy(Context);
+  Value *DestPtr = Builder.CreateBitCast(DestLoc.Ptr, BytePtrTy);
+  Value *SrcPtr = Builder.CreateBitCast(SrcLoc.Ptr, BytePtrTy);
+  for (uint64_t Offset = 0; Offset != Size;) {
+    unsigned Bytes = ChunkSize;
+    while (Bytes > Size - Offset)
+      Bytes /= 2;
+    Type *ChunkPtrTy = getChunkType(Bytes, Context)->getPointerTo();
+    Value *Src = Builder.CreateConstInBoundsGEP1_64(SrcPtr, Offset);
+    Value *Dest = Builder.CreateConstInBoundsGEP1_64(DestPtr, Offset);
+    Value *Val = Builder.CreateAlignedLoad(
+        Builder.CreateBitCast(Src, ChunkPtrTy),
+        MinAlign(SrcLoc.getAlignment(), Offset));
+    Builder.CreateAlignedStore(Val, Builder.CreateBitCast(Dest, ChunkPtrTy),
+                               MinAlign(DestLoc.getAlignment(), Offset));
+    Offset += Bytes;
+  }
+}
+
+/// ZeroByChunks - Zero Size octets at DestLoc using stores of at most ChunkSize
+/// octets.  Helper for EmitAggregateZero.
+void TreeToLLVM::ZeroByChunks(MemRef DestLoc, uint64_t Size,
+                              unsigned ChunkSize) {
+  Value *DestPtr = Builder.CreateBitCast(DestLoc.Ptr,
+                                         Type::getInt8PtrTy(Context));
+  for (uint64_t Offset = 0; Offset != Size;) {
+    unsigned Bytes = ChunkSize;
+    while (Bytes > Size - Offset)
+      Bytes /= 2;
+    Type *ChunkTy = getChunkType(Bytes, Context);
+    Value *Dest = Builder.CreateConstInBoundsGEP1_64(DestPtr, Offset);
+    Builder.CreateAlignedStore(
+        Constant::getNullValue(ChunkTy),
+        Builder.CreateBitCast(Dest, ChunkTy->getPointerTo()),
+        MinAlign(DestLoc.getAlignment(), Offset));
+    Offset += Bytes;
+  }
+}
+
 /// CopyElementByElement - Recursively traverse the potentially aggregate
 /// src/dest ptrs, copying all of the elements.  Helper for EmitAggregateCopy.
 void TreeToLLVM::CopyElementByElement(MemRef DestLoc, MemRef SrcLoc,
@@ -2217,8 +2643,15 @@ void TreeToLLVM::EmitAggregateCopy(MemRef DestLoc, MemRef SrcLoc, tree type) {
   if (DestLoc.Ptr == SrcLoc.Ptr && !DestLoc.Volatile && !SrcLoc.Volatile)
     return; // noop copy.
 
-  // If the type is small, copy element by element instead of using memcpy.
+  // If a short run of wide loads and stores does the job then use that.
   unsigned Cost = CostOfAccessingAllElements(type);
+  if (unsigned ChunkSize = getInlineChunkSize(type, DestLoc, &SrcLoc, Cost)) {
+    CopyByChunks(DestLoc, SrcLoc, getInt64(TYPE_SIZE_UNIT(type), true),
+                 ChunkSize);
+    return;
+  }
+
+  // If the type is small, copy element by element instead of using memcpy.
   if (Cost < TooCostly && Cost < TARGET_DRAGONEGG_MEMCPY_COST) {
     CopyElementByElement(DestLoc, SrcLoc, type);
     return;
@@ -2302,8 +2735,14 @@ void TreeToLLVM::ZeroElementByElement(MemRef DestLoc, tree type) {
 
 /// EmitAggregateZero - Zero the elements of DestLoc.
 void TreeToLLVM::EmitAggregateZero(MemRef DestLoc, tree type) {
-  // If the type is small, zero element by element instead of using memset.
+  // If a short run of wide stores does the job then use that.
   unsigned Cost = CostOfAccessingAllElements(type);
+  if (unsigned ChunkSize = getInlineChunkSize(type, DestLoc, 0, Cost)) {
+    ZeroByChunks(DestLoc, getInt64(TYPE_SIZE_UNIT(type), true), ChunkSize);
+    return;
+  }
+
+  // If the type is small, zero element by element instead of using memset.
   if (Cost < TooCostly && Cost < TARGET_DRAGONEGG_MEMSET_COST) {
     ZeroElementByElement(DestLoc, type);
     return;
@@ -2457,7 +2896,8 @@ void TreeToLLVM::EmitAutomaticVariableDecl(tree decl) {
     Ty = Type::getInt8Ty(Context);
   }
 
-  unsigned Alignment = DECL_ALIGN(decl) / 8; // Alignment in octets.
+  // Alignment in octets.
+  unsigned Alignment = (Size ? DECL_ALIGN(decl) : getDataAlignment(decl)) / 8;
   assert(Alignment != 0 && "Local variable with unknown alignment!");
 
   // If this is the alignment we would have given the variable anyway and it was
@@ -2869,6 +3309,45 @@ static bool canEmitRegisterVariable(tree exp) {
   return false;
 }
 
+/// getBitfieldAccessSize - Return the number of bits to load or store when
+/// accessing the bitfield LV of the expression exp.  This is the minimum number
+/// of bytes that covers the field, except for volatile bitfields when using
+/// -fstrict-volatile-bitfields.  Like GCC, these are then accessed using the
+/// declared type of the field, and LV is moved back to the start of the unit.
+unsigned TreeToLLVM::getBitfieldAccessSize(tree exp, LValue &LV) {
+  unsigned Size = RoundUpToAlignment(LV.BitStart + LV.BitSize, BITS_PER_UNIT);
+#if (GCC_MINOR > 5)
+  if (!LV.Volatile || flag_strict_volatile_bitfields <= 0 ||
+      !isa<COMPONENT_REF>(exp))
+    return Size;
+  tree field = TREE_OPERAND(exp, 1);
+  if (!DECL_BIT_FIELD_TYPE(field) || !OffsetIsLLVMCompatible(field) ||
+      !isInt64(TYPE_SIZE(DECL_BIT_FIELD_TYPE(field)), true))
+    return Size;
+  uint64_t UnitSize = getInt64(TYPE_SIZE(DECL_BIT_FIELD_TYPE(field)), true);
+  uint64_t FieldStart = getFieldOffsetInBits(field);
+  uint64_t UnitStart = FieldStart - FieldStart % UnitSize;
+  // If the field straddles two units then GCC falls back to the usual access.
+  if (UnitSize < Size || UnitSize > 64 || FieldStart % 8 != LV.BitStart ||
+      FieldStart + LV.BitSize > UnitStart + UnitSize)
+    return Size;
+
+  // LV points to the octet containing the first bit of the field.
+  if (unsigned Displacement = FieldStart / 8 - UnitStart / 8) {
+    Value *Ptr = Builder.CreateBitCast(LV.Ptr, Type::getInt8PtrTy(Context));
+    LV.Ptr = Builder.CreateGEP(
+        Ptr, ConstantInt::getSigned(Type::getInt32Ty(Context),
+                                     -int64_t(Displacement)));
+    LV.setAlignment(MinAlign(LV.getAlignment(), Displacement));
+  }
+  LV.BitStart = FieldStart - UnitStart;
+  return UnitSize;
+#else
+  (void)exp;
+  return Size;
+#endif
+}
+
 /// EmitLoadOfLValue - When an l-value expression is used in a context that
 /// requires an r-value, this method emits the lvalue computation, then loads
 /// the result.
@@ -2882,7 +3361,6 @@ Value *TreeToLLVM::EmitLoadOfLValue(tree exp) {
   LValue LV = EmitLV(exp);
   LV.Volatile = TREE_THIS_VOLATILE(exp);
   // TODO: Arrange for Volatile to already be set in the LValue.
-  unsigned Alignment = LV.getAlignment();
 
   tree type = TREE_TYPE(exp);
   if (!LV.isBitfield())
@@ -2894,9 +3372,9 @@ Value *TreeToLLVM::EmitLoadOfLValue(tree exp) {
   if (!LV.BitSize)
     return Constant::getNullValue(Ty);
 
-  // Load the minimum number of bytes that covers the field.
-  unsigned LoadSizeInBits = LV.BitStart + LV.BitSize;
-  LoadSizeInBits = RoundUpToAlignment(LoadSizeInBits, BITS_PER_UNIT);
+  // Load the bits that cover the field.
+  unsigned LoadSizeInBits = getBitfieldAccessSize(exp, LV);
+  unsigned Alignment = LV.getAlignment();
   Type *LoadType = IntegerType::get(Context, LoadSizeInBits);
 
   // Load the bits.
@@ -2955,6 +3433,51 @@ Value *TreeToLLVM::EmitADDR_EXPR(tree exp) {
   return Builder.CreateBitCast(LV.Ptr, getRegType(TREE_TYPE(exp)));
 }
 
+/// getVectorLanes - If the BIT_FIELD_REF exp selects whole elements of a
+/// vector, and the value it produces has exactly the bits of those elements,
+/// return true and set FirstLane and NumLanes to the elements selected.
+static bool getVectorLanes(tree exp, unsigned &FirstLane, unsigned &NumLanes) {
+  tree vec_type = TREE_TYPE(TREE_OPERAND(exp, 0));
+  if (!isa<VECTOR_TYPE>(vec_type) || !isInt64(TREE_OPERAND(exp, 1), true) ||
+      !isInt64(TREE_OPERAND(exp, 2), true))
+    return false;
+
+  // Vectors of pointers and the like are rare - just do them the old way.
+  Type *EltTy = getRegType(TREE_TYPE(vec_type));
+  Type *ResTy = getRegType(TREE_TYPE(exp));
+  if (!EltTy->isIntegerTy() && !EltTy->isFloatingPointTy())
+    return false;
+  if (!ResTy->isIntegerTy() && !ResTy->isFloatingPointTy() &&
+      !ResTy->isVectorTy())
+    return false;
+
+  uint64_t EltBits = EltTy->getPrimitiveSizeInBits();
+  uint64_t BitSize = getInt64(TREE_OPERAND(exp, 1), true);
+  uint64_t BitStart = getInt64(TREE_OPERAND(exp, 2), true);
+  if (!BitSize || BitSize % EltBits || BitStart % EltBits ||
+      ResTy->getPrimitiveSizeInBits() != BitSize ||
+      (BitStart + BitSize) / EltBits > TYPE_VECTOR_SUBPARTS(vec_type))
+    return false;
+
+  FirstLane = BitStart / EltBits;
+  NumLanes = BitSize / EltBits;
+  return true;
+}
+
+/// EmitBIT_FIELD_REF - A BIT_FIELD_REF of a vector register that picks out some
+/// of its elements is turned into vector operations, saving a trip through
+/// memory.  Anything else is loaded from its l-value.
+Value *TreeToLLVM::EmitBIT_FIELD_REF(tree exp) {
+  tree op = TREE_OPERAND(exp, 0);
+  unsigned FirstLane, NumLanes;
+  if ((isa<SSA_NAME>(op) || isa<VECTOR_CST>(op)) &&
+      getVectorLanes(exp, FirstLane, NumLanes))
+    return Builder.CreateBitCast(
+        VectorExtractLanes(EmitRegister(op), FirstLane, NumLanes),
+        getRegType(TREE_TYPE(exp)));
+  return EmitLoadOfLValue(exp);
+}
+
 #if (GCC_MINOR < 7)
 Value *TreeToLLVM::EmitCondExpr(tree exp) {
   return TriviallyTypeConvert(
@@ -3276,8 +3799,16 @@ struct FunctionCallArgumentConversion : public DefaultABIClient {
   /// HandleByInvisibleReferenceArgument - This callback is invoked if a
   /// pointer (of type PtrTy) to the argument is passed rather than the
   /// argument itself.
-  void HandleByInvisibleReferenceArgument(llvm::Type *PtrTy, tree /*type*/) {
+  void HandleByInvisibleReferenceArgument(llvm::Type *PtrTy, tree type) {
     Value *Loc = getAddress();
+    if (type && !isPassedByInvisibleReference(type)) {
+      // The target passes this aggregate by reference even though GCC does
+      // not, so the callee is free to modify it: pass a copy.
+      MemRef Tmp = TheTreeToLLVM->CreateTempLoc(ConvertType(type));
+      TheTreeToLLVM->EmitAggregateCopy(
+          Tmp, MemRef(Loc, TYPE_ALIGN_UNIT(type), false), type);
+      Loc = Tmp.Ptr;
+    }
     Loc = Builder.CreateBitCast(Loc, PtrTy);
     CallOperands.push_back(Loc);
   }
@@ -3317,6 +3848,20 @@ struct FunctionCallArgumentConversion : public DefaultABIClient {
 };
 }
 
+/// isMatchingABIPlan - Return whether the plan was recorded for a call with the
+/// same result type, argument types and calling convention as 'stmt'.
+static bool isMatchingABIPlan(const ABIPlan &Plan, gimple stmt,
+                              CallingConv::ID CC) {
+  if (Plan.CallingConv != CC ||
+      Plan.ResultType != gimple_call_return_type(stmt) ||
+      Plan.ArgTypes.size() != gimple_call_num_args(stmt))
+    return false;
+  for (unsigned i = 0, e = gimple_call_num_args(stmt); i != e; ++i)
+    if (Plan.ArgTypes[i] != TREE_TYPE(gimple_call_arg(stmt, i)))
+      return false;
+  return true;
+}
+
 /// EmitCallOf - Emit a call to the specified callee with the operands specified
 /// in the GIMPLE_CALL 'stmt'. If the result of the call is a scalar, return the
 /// result, otherwise store it in DestLoc.
@@ -3380,12 +3925,28 @@ Value *TreeToLLVM::EmitCallOf(Value *Callee, gimple stmt, const MemRef *DestLoc,
   FunctionCallArgumentConversion Client(CallOperands, FTy, DestLoc,
                                         gimple_call_return_slot_opt_p(stmt),
                                         Builder, CallingConvention);
-  DefaultABI ABIConverter(Client);
+
+  // If calls with this signature were lowered before then replay the recorded
+  // client callbacks rather than classifying the result and arguments again.
+  // Otherwise lower the call while recording a plan for next time.
+  tree CalleeKey = fndecl ? fndecl : fntype;
+  ABIPlan *Plan = getCachedABIPlan(CalleeKey, fntype);
+  if (Plan && !isMatchingABIPlan(*Plan, stmt, CallingConvention))
+    Plan = 0;
+  if (Plan)
+    ++NumCallPlansReused;
+  ABIPlan NewPlan;
+  NewPlan.ResultType = gimple_call_return_type(stmt);
+  NewPlan.CallingConv = CallingConvention;
+  ABIPlanRecorder Recorder(Client, NewPlan);
+  DefaultABI ABIConverter(Recorder);
 
   // Handle the result, including struct returns.
-  ABIConverter.HandleReturnType(gimple_call_return_type(stmt),
-                                fndecl ? fndecl : fntype,
-                                fndecl ? DECL_BUILT_IN(fndecl) : false);
+  if (Plan)
+    ABIPlan::Replay(Plan->ResultSteps, Client);
+  else
+    ABIConverter.HandleReturnType(gimple_call_return_type(stmt), CalleeKey,
+                                  fndecl ? DECL_BUILT_IN(fndecl) : false);
 
   // Pass the static chain, if any, as the first parameter.
   if (gimple_call_chain(stmt))
@@ -3430,7 +3991,14 @@ Value *TreeToLLVM::EmitCallOf(Value *Callee, gimple stmt, const MemRef *DestLoc,
 
     unsigned OldSize = CallOperands.size();
 
-    ABIConverter.HandleArgument(type, ScalarArgs, &AttrBuilder);
+    if (Plan) {
+      ABIPlan::Replay(Plan->ArgSteps[i], Client);
+      AttrBuilder = Plan->ArgAttrs[i];
+    } else {
+      Recorder.BeginArgument(type);
+      ABIConverter.HandleArgument(type, ScalarArgs, &AttrBuilder);
+      Recorder.EndArgument(AttrBuilder);
+    }
 
     if (AttrBuilder.hasAttributes()) {
       // If the argument is split into multiple scalars, assign the
@@ -3443,6 +4011,9 @@ Value *TreeToLLVM::EmitCallOf(Value *Callee, gimple stmt, const MemRef *DestLoc,
     Client.clear();
   }
 
+  if (!Plan)
+    setCachedABIPlan(CalleeKey, fntype, NewPlan);
+
   // If the caller and callee disagree about a parameter type but the difference
   // is trivial, correct the type used by the caller.
   for (unsigned i = 0, e = std::min((unsigned) CallOperands.size(),
@@ -3469,6 +4040,18 @@ Value *TreeToLLVM::EmitCallOf(Value *Callee, gimple stmt, const MemRef *DestLoc,
     Call = Builder.CreateCall(Callee, CallOperands);
     cast<CallInst>(Call)->setCallingConv(CallingConvention);
     cast<CallInst>(Call)->setAttributes(PAL);
+
+    // GCC's tail call pass only marks calls that cannot refer to the caller's
+    // local variables.  However the call may have been handed the address of a
+    // temporary created above, for example to hold an aggregate argument or the
+    // return value, in which case it must not be a tail call.
+    if (gimple_call_tail_p(stmt)) {
+      bool UsesFrame = false;
+      for (unsigned i = 0, e = CallOperands.size(); i != e && !UsesFrame; ++i)
+        UsesFrame = isStackAddress(CallOperands[i]);
+      if (!UsesFrame)
+        cast<CallInst>(Call)->setTailCall();
+    }
   } else {
     BasicBlock *NextBlock = BasicBlock::Create(Context);
     Call = Builder.CreateInvoke(Callee, NextBlock, LandingPad, CallOperands);
@@ -6245,6 +6828,21 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
       return FieldPtr;
     }
 
+    /// CastToGEPIndex - Convert an index of the given GCC integer type into a
+    /// form suitable for indexing a getelementptr with the given pointer-sized
+    /// integer type.  Since getelementptr sign extends narrower indices itself,
+    /// signed indices are left as they are, keeping extensions out of the IR.
+    /// Unsigned indices are zero extended and over-wide ones are truncated.
+    static Value *CastToGEPIndex(Value *Index, Type *IntPtrTy, tree type,
+                                 LLVMBuilder &Builder) {
+      unsigned IndexBits = Index->getType()->getPrimitiveSizeInBits();
+      unsigned PtrBits = IntPtrTy->getPrimitiveSizeInBits();
+      if (!TYPE_UNSIGNED(type) && IndexBits < PtrBits)
+        return Index;
+      return Builder.CreateIntCast(Index, IntPtrTy,
+                                   /*isSigned*/ !TYPE_UNSIGNED(type));
+    }
+
     LValue TreeToLLVM::EmitLV_ARRAY_REF(tree exp) {
       // The result type is an ElementTy* in the case of an ARRAY_REF, an array
       // of ElementTy in the case of ARRAY_RANGE_REF.
@@ -6274,11 +6872,10 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
       ArrayAlign = ArrayAddrLV.getAlignment();
 
       Type *IntPtrTy = getDataLayout().getIntPtrType(ArrayAddr->getType());
-      IndexVal = Builder.CreateIntCast(IndexVal, IntPtrTy,
-                                       /*isSigned*/ !TYPE_UNSIGNED(IndexType));
 
       // If we are indexing over a fixed-size type, just use a GEP.
       if (isSizeCompatible(ElementType)) {
+        IndexVal = CastToGEPIndex(IndexVal, IntPtrTy, IndexType, Builder);
         // Avoid any assumptions about how the array type is represented in LLVM by
         // doing the GEP on a pointer to the first array element.
         Type *EltTy = ConvertType(ElementType);
@@ -6300,6 +6897,7 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
       //   float foo(int w, float A[][w], int g) { return A[g][0]; }
 
       if (isa<VOID_TYPE>(TREE_TYPE(ArrayTreeType))) {
+        IndexVal = CastToGEPIndex(IndexVal, IntPtrTy, IndexType, Builder);
         ArrayAddr =
             Builder.CreateBitCast(ArrayAddr, Type::getInt8PtrTy(Context));
         StringRef GEPName = flag_verbose_asm ? "va" : "";
@@ -6315,6 +6913,8 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
              "Size missing for variable sized element!");
       // ScaleFactor is the size of the element type in units divided by (exactly)
       // TYPE_ALIGN_UNIT(ElementType).
+      IndexVal = Builder.CreateIntCast(IndexVal, IntPtrTy,
+                                       /*isSigned*/ !TYPE_UNSIGNED(IndexType));
       Value *ScaleFactor = Builder.CreateIntCast(
           EmitRegister(TREE_OPERAND(exp, 3)), IntPtrTy, /*isSigned*/ false);
       assert(isPowerOf2_32(TYPE_ALIGN(ElementType)) &&
@@ -6940,6 +7540,54 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
                                          ConstantVector::get(Mask));
     }
 
+    /// VectorExtractLanes - Return the NumLanes elements of the given vector
+    /// that start at index FirstLane.  A single element is returned as a
+    /// scalar.
+    Value *TreeToLLVM::VectorExtractLanes(Value * Vec, unsigned FirstLane,
+                                          unsigned NumLanes) {
+      if (NumLanes == 1)
+        return Builder.CreateExtractElement(Vec, Builder.getInt32(FirstLane));
+      VectorType *Ty = cast<VectorType>(Vec->getType());
+      if (FirstLane == 0 && NumLanes == Ty->getNumElements())
+        return Vec;
+      SmallVector<Constant *, 8> Mask;
+      Mask.reserve(NumLanes);
+      for (unsigned i = 0; i != NumLanes; ++i)
+        Mask.push_back(Builder.getInt32(FirstLane + i));
+      return Builder.CreateShuffleVector(Vec, UndefValue::get(Ty),
+                                         ConstantVector::get(Mask));
+    }
+
+    /// VectorInsertLanes - Return the given vector with the elements starting
+    /// at index FirstLane replaced by Lanes, which is either a scalar of the
+    /// vector element type or a shorter vector with the same element type.
+    Value *TreeToLLVM::VectorInsertLanes(Value * Vec, Value * Lanes,
+                                         unsigned FirstLane) {
+      VectorType *Ty = cast<VectorType>(Vec->getType());
+      VectorType *LanesTy = dyn_cast<VectorType>(Lanes->getType());
+      if (!LanesTy)
+        return Builder.CreateInsertElement(Vec, Lanes,
+                                           Builder.getInt32(FirstLane));
+      unsigned NumElts = Ty->getNumElements();
+      unsigned NumLanes = LanesTy->getNumElements();
+      if (NumLanes == NumElts)
+        return Lanes;
+
+      // Widen the new elements to the length of the vector, then blend them in.
+      SmallVector<Constant *, 8> Mask;
+      Mask.reserve(NumElts);
+      for (unsigned i = 0; i != NumElts; ++i)
+        Mask.push_back(i < NumLanes ? Builder.getInt32(i)
+                                    : UndefValue::get(Builder.getInt32Ty()));
+      Lanes = Builder.CreateShuffleVector(Lanes, UndefValue::get(LanesTy),
+                                          ConstantVector::get(Mask));
+      for (unsigned i = 0; i != NumElts; ++i)
+        Mask[i] = Builder.getInt32(
+            i >= FirstLane && i < FirstLane + NumLanes ? NumElts + i - FirstLane
+                                                       : i);
+      return Builder.CreateShuffleVector(Vec, Lanes, ConstantVector::get(Mask));
+    }
+
     //===----------------------------------------------------------------------===//
     //           ... EmitReg* - Convert register expression to LLVM...
     //===----------------------------------------------------------------------===//
@@ -6976,7 +7624,8 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
       assert(is_gimple_reg_type(TREE_TYPE(reg)) && "Not of register type!");
 
       // If we already found the definition of the SSA name, return it.
-      if (Value *ExistingValue = SSANames[reg]) {
+      AssertingVH<Value> &Slot = getSSANameSlot(reg);
+      if (Value *ExistingValue = Slot) {
         assert(ExistingValue->getType() == getRegType(TREE_TYPE(reg)) &&
                "SSA name has wrong type!");
         if (!isSSAPlaceholder(ExistingValue))
@@ -6985,9 +7634,9 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
 
       // If this is not the definition of the SSA name, return a placeholder value.
       if (!SSA_NAME_IS_DEFAULT_DEF(reg)) {
-        if (Value *ExistingValue = SSANames[reg])
+        if (Value *ExistingValue = Slot)
           return ExistingValue; // The type was sanity checked above.
-        return SSANames[reg] = GetSSAPlaceholder(getRegType(TREE_TYPE(reg)));
+        return Slot = GetSSAPlaceholder(getRegType(TREE_TYPE(reg)));
       }
 
       // This SSA name is the default definition for the underlying symbol.
@@ -7807,22 +8456,56 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
         SplitComplex(RHS, RHSr, RHSi);
         Value *DSTr, *DSTi;
 
-        // (a+ib) / (c+id) = ((ac+bd)/(cc+dd)) + i((bc-ad)/(cc+dd))
         assert(isa<REAL_TYPE>(TREE_TYPE(type)) &&
                "RDIV_EXPR not floating point!");
-        Value *Tmp1 = Builder.CreateFMul(LHSr, RHSr); // a*c
-        Value *Tmp2 = Builder.CreateFMul(LHSi, RHSi); // b*d
-        Value *Tmp3 = Builder.CreateFAdd(Tmp1, Tmp2); // ac+bd
+        if (!flag_complex_method) {
+          // The range of the operands is limited (-fcx-limited-range, implied
+          // by -ffast-math) so use the textbook formula, multiplying by the
+          // reciprocal of the denominator rather than dividing twice:
+          // (a+ib) / (c+id) = ((ac+bd)/(cc+dd)) + i((bc-ad)/(cc+dd))
+          Value *Tmp1 = Builder.CreateFMul(LHSr, RHSr); // a*c
+          Value *Tmp2 = Builder.CreateFMul(LHSi, RHSi); // b*d
+          Value *Tmp3 = Builder.CreateFAdd(Tmp1, Tmp2); // ac+bd
+
+          Value *Tmp4 = Builder.CreateFMul(RHSr, RHSr); // c*c
+          Value *Tmp5 = Builder.CreateFMul(RHSi, RHSi); // d*d
+          Value *Tmp6 = Builder.CreateFAdd(Tmp4, Tmp5); // cc+dd
+          Value *Recip =
+              Builder.CreateFDiv(ConstantFP::get(Tmp6->getType(), 1.0), Tmp6);
+          DSTr = Builder.CreateFMul(Tmp3, Recip);
 
-        Value *Tmp4 = Builder.CreateFMul(RHSr, RHSr); // c*c
-        Value *Tmp5 = Builder.CreateFMul(RHSi, RHSi); // d*d
-        Value *Tmp6 = Builder.CreateFAdd(Tmp4, Tmp5); // cc+dd
-        DSTr = Builder.CreateFDiv(Tmp3, Tmp6);
+          Value *Tmp7 = Builder.CreateFMul(LHSi, RHSr); // b*c
+          Value *Tmp8 = Builder.CreateFMul(LHSr, RHSi); // a*d
+          Value *Tmp9 = Builder.CreateFSub(Tmp7, Tmp8); // bc-ad
+          DSTi = Builder.CreateFMul(Tmp9, Recip);
 
-        Value *Tmp7 = Builder.CreateFMul(LHSi, RHSr); // b*c
-        Value *Tmp8 = Builder.CreateFMul(LHSr, RHSi); // a*d
-        Value *Tmp9 = Builder.CreateFSub(Tmp7, Tmp8); // bc-ad
-        DSTi = Builder.CreateFDiv(Tmp9, Tmp6);
+          return CreateComplex(DSTr, DSTi);
+        }
+
+        // Otherwise use Smith's algorithm, which scales by the bigger of c and
+        // d to avoid overflow and underflow in the intermediate results:
+        //   |c| >= |d|: r = d/c, s = c+dr, ((a+br)/s) + i((b-ar)/s)
+        //   |c| <  |d|: r = c/d, s = cr+d, ((ar+b)/s) + i((br-a)/s)
+        // The two cases are the same up to swapping c with d and a with b, and
+        // negating the imaginary part, so select the operands rather than
+        // branching.
+        Type *EltTy = RHSr->getType();
+        Function *Fabs = Intrinsic::getDeclaration(TheModule, Intrinsic::fabs,
+                                                   EltTy);
+        Value *CmpAbs = Builder.CreateFCmpOGE(Builder.CreateCall(Fabs, RHSr),
+                                              Builder.CreateCall(Fabs, RHSi));
+        Value *Big = Builder.CreateSelect(CmpAbs, RHSr, RHSi);    // c or d
+        Value *Small = Builder.CreateSelect(CmpAbs, RHSi, RHSr);  // d or c
+        Value *First = Builder.CreateSelect(CmpAbs, LHSr, LHSi);  // a or b
+        Value *Second = Builder.CreateSelect(CmpAbs, LHSi, LHSr); // b or a
+        Value *Ratio = Builder.CreateFDiv(Small, Big);            // r
+        Value *Scale =
+            Builder.CreateFAdd(Big, Builder.CreateFMul(Small, Ratio)); // s
+        Value *Tmp1 = Builder.CreateFMul(Second, Ratio);
+        DSTr = Builder.CreateFDiv(Builder.CreateFAdd(First, Tmp1), Scale);
+        Value *Tmp2 = Builder.CreateFMul(First, Ratio);
+        DSTi = Builder.CreateFDiv(Builder.CreateFSub(Second, Tmp2), Scale);
+        DSTi = Builder.CreateSelect(CmpAbs, DSTi, Builder.CreateFNeg(DSTi));
 
         return CreateComplex(DSTr, DSTi);
       }
@@ -8762,6 +9445,10 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
           Function *EndIntr =
               Intrinsic::getDeclaration(TheModule, Intrinsic::lifetime_end);
           Builder.CreateCall2(EndIntr, Builder.getInt64(LHSSize), LHSAddr);
+          // The matching lifetime starts are output once the whole function
+          // is known, see EmitLifetimeStarts.
+          if (AllocaInst *AI = dyn_cast<AllocaInst>(DECL_LOCAL(lhs)))
+            ClobberedLocals.push_back(AI);
         }
         return;
       }
@@ -8997,6 +9684,32 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
       Builder.CreateBr(ReturnBB);
     }
 
+    namespace {
+    /// CaseRange - A switch case range too wide to be expanded into individual
+    /// switch instruction cases.
+    struct CaseRange {
+      ConstantInt *Low, *High;
+      BasicBlock *Dest;
+    };
+
+    /// CaseRangeTree - A sequence of case ranges, still to be dispatched on,
+    /// along with the basic block from which to dispatch.
+    struct CaseRangeTree {
+      BasicBlock *BB;
+      unsigned Begin, End;
+    };
+    }
+
+    /// EmitCaseRangeTest - Emit a test of whether the switch index lies in the
+    /// given case range.
+    static Value *EmitCaseRangeTest(LLVMBuilder &Builder, Value *Index,
+                                    const CaseRange &R) {
+      APInt Range = R.High->getValue() - R.Low->getValue();
+      Value *Diff = Builder.CreateSub(Index, R.Low);
+      return Builder.CreateICmpULE(Diff,
+                                   ConstantInt::get(Index->getContext(), Range));
+    }
+
     void TreeToLLVM::RenderGIMPLE_SWITCH(gimple stmt) {
       // Emit the condition.
       Value *Index = EmitRegister(gimple_switch_index(stmt));
@@ -9008,8 +9721,9 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
           Builder.CreateSwitch(Index, getLabelDeclBlock(default_label),
                                gimple_switch_num_labels(stmt));
 
-      // Add the switch cases.
-      BasicBlock *IfBlock = 0; // Set if a range was output as an "if".
+      // Add the switch cases.  Ranges too big to add to the switch are put in
+      // Ranges, in increasing order since GCC sorts the case labels.
+      SmallVector<CaseRange, 8> Ranges;
       for (unsigned i = 1, e = gimple_switch_num_labels(stmt); i != e; ++i) {
         tree label = gimple_switch_label(stmt, i);
         BasicBlock *Dest = getLabelDeclBlock(CASE_LABEL(label));
@@ -9040,23 +9754,59 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
             LowC = ConstantInt::get(Context, CurrentValue);
           }
         } else {
-          // The range is too big to add to the switch - emit an "if".
-          if (!IfBlock) {
-            IfBlock = BasicBlock::Create(Context);
-            BeginBlock(IfBlock);
-          }
-          Value *Diff = Builder.CreateSub(Index, LowC);
-          Value *Cond =
-              Builder.CreateICmpULE(Diff, ConstantInt::get(Context, Range));
-          BasicBlock *False_Block = BasicBlock::Create(Context);
-          Builder.CreateCondBr(Cond, Dest, False_Block);
-          BeginBlock(False_Block);
+          CaseRange R = { LowC, HighC, Dest };
+          Ranges.push_back(R);
         }
       }
 
-      if (IfBlock) {
-        Builder.CreateBr(SI->getDefaultDest());
-        SI->setDefaultDest(IfBlock);
+      if (Ranges.empty())
+        return;
+
+      // Values that are not handled by the switch are dispatched to the right
+      // range using a balanced binary decision tree, so that this only takes a
+      // logarithmic number of comparisons.  Indices not in any of the ranges end
+      // up at the original default destination.  A handful of ranges is simply
+      // tested one after the other.
+      const unsigned MaxRangesInChain = 3;
+      bool IndexIsSigned = !TYPE_UNSIGNED(index_type);
+      BasicBlock *DefaultDest = SI->getDefaultDest();
+      SmallVector<CaseRangeTree, 8> Worklist;
+      CaseRangeTree Root = { BasicBlock::Create(Context), 0,
+                             (unsigned) Ranges.size() };
+      SI->setDefaultDest(Root.BB);
+      Worklist.push_back(Root);
+      while (!Worklist.empty()) {
+        CaseRangeTree T = Worklist.pop_back_val();
+        BeginBlock(T.BB);
+
+        if (T.End - T.Begin <= MaxRangesInChain) {
+          for (unsigned i = T.Begin; i != T.End; ++i) {
+            Value *Cond = EmitCaseRangeTest(Builder, Index, Ranges[i]);
+            BasicBlock *Next =
+                i + 1 == T.End ? DefaultDest : BasicBlock::Create(Context);
+            Builder.CreateCondBr(Cond, Ranges[i].Dest, Next);
+            if (Next != DefaultDest)
+              BeginBlock(Next);
+          }
+          continue;
+        }
+
+        // Test the middle range.  If the index is not in it then continue with
+        // the ranges below or the ranges above it as appropriate.
+        unsigned Mid = T.Begin + (T.End - T.Begin) / 2;
+        const CaseRange &R = Ranges[Mid];
+        BasicBlock *NotInRange = BasicBlock::Create(Context);
+        Builder.CreateCondBr(EmitCaseRangeTest(Builder, Index, R), R.Dest,
+                             NotInRange);
+        BeginBlock(NotInRange);
+
+        CaseRangeTree Below = { BasicBlock::Create(Context), T.Begin, Mid };
+        CaseRangeTree Above = { BasicBlock::Create(Context), Mid + 1, T.End };
+        Value *IsBelow = IndexIsSigned ? Builder.CreateICmpSLT(Index, R.Low)
+                                       : Builder.CreateICmpULT(Index, R.Low);
+        Builder.CreateCondBr(IsBelow, Below.BB, Above.BB);
+        Worklist.push_back(Above);
+        Worklist.push_back(Below);
       }
     }
 
@@ -9320,9 +10070,10 @@ bool TreeToLLVM::EmitBuiltinCall(gimple stmt, tree fndecl,
                                        : EmitCONSTRUCTOR(rhs, 0);
 
         // References (tcc_reference).
+      case BIT_FIELD_REF:
+        return EmitBIT_FIELD_REF(rhs);
       case ARRAY_REF:
       case ARRAY_RANGE_REF:
-      case BIT_FIELD_REF:
       case COMPONENT_REF:
       case IMAGPART_EXPR:
       case INDIRECT_REF:
@@ -9436,6 +10187,33 @@ void TreeToLLVM::WriteScalarToLHS(tree lhs, Value * RHS) {
     return;
   }
 
+  // Storing to some of the elements of a local vector variable that does not
+  // have its address taken: replace the elements in the vector value.  This is
+  // not done for other vectors, since writing back the untouched elements could
+  // race with a store to them from elsewhere.
+  unsigned FirstLane, NumLanes;
+  if (isa<BIT_FIELD_REF>(lhs) && !TREE_THIS_VOLATILE(lhs) &&
+      getVectorLanes(lhs, FirstLane, NumLanes)) {
+    tree var = TREE_OPERAND(lhs, 0);
+    if ((isa<VAR_DECL>(var) || isa<PARM_DECL>(var)) &&
+        !TREE_THIS_VOLATILE(var) && !TREE_ADDRESSABLE(var) &&
+        !canEmitRegisterVariable(var)) {
+      LValue VecLV = EmitLV(var);
+      if (isa<AllocaInst>(VecLV.Ptr)) {
+        tree vec_type = TREE_TYPE(var);
+        MDNode *AliasTag = describeAliasSet(var);
+        Value *Vec = LoadRegisterFromMemory(VecLV, vec_type, AliasTag, Builder);
+        Type *LanesTy = cast<VectorType>(Vec->getType())->getElementType();
+        if (NumLanes != 1)
+          LanesTy = VectorType::get(LanesTy, NumLanes);
+        Vec = VectorInsertLanes(Vec, Builder.CreateBitCast(RHS, LanesTy),
+                                FirstLane);
+        StoreRegisterToMemory(Vec, VecLV, vec_type, AliasTag, Builder);
+        return;
+      }
+    }
+  }
+
   LValue LV = EmitLV(lhs);
   LV.Volatile = TREE_THIS_VOLATILE(lhs);
   // TODO: Arrange for Volatile to already be set in the LValue.
@@ -9450,10 +10228,8 @@ void TreeToLLVM::WriteScalarToLHS(tree lhs, Value * RHS) {
   if (!LV.BitSize)
     return;
 
-  // Load and store the minimum number of bytes that covers the field.
-  unsigned LoadSizeInBits = LV.BitStart + LV.BitSize;
-  LoadSizeInBits =
-      (unsigned) RoundUpToAlignment(LoadSizeInBits, BITS_PER_UNIT);
+  // Load and store the bits that cover the field.
+  unsigned LoadSizeInBits = getBitfieldAccessSize(lhs, LV);
   Type *LoadType = IntegerType::get(Context, LoadSizeInBits);
 
   // Load the existing bits.
@@ -9518,3 +10294,85 @@ void TreeToLLVM::WriteScalarToLHS(tree lhs, Value * RHS) {
   Val = Builder.CreateOr(Val, RHS);
   Builder.CreateAlignedStore(Val, Ptr, LV.getAlignment(), LV.Volatile);
 }
+
+/// EmitBitfieldStores - Output a run of stores to neighbouring bitfields of the
+/// same object, as found by getBitfieldStoreGroup, using a single load and
+/// store of the memory holding them.
+void TreeToLLVM::EmitBitfieldStores(ArrayRef<gimple> Stores) {
+  tree first = gimple_assign_lhs(Stores[0]);
+
+  // Work out which octets of the object are written to.
+  uint64_t LoBit = ~0ULL, HiBit = 0;
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    tree field = TREE_OPERAND(gimple_assign_lhs(Stores[i]), 1);
+    uint64_t FieldStart = getFieldOffsetInBits(field);
+    LoBit = std::min(LoBit, FieldStart);
+    HiBit = std::max(HiBit, FieldStart + getInt64(DECL_SIZE(field), true));
+  }
+  uint64_t Start = LoBit / 8;
+  uint64_t Bytes = (HiBit + 7) / 8 - Start;
+
+#if (GCC_MINOR > 6)
+  // The memory touched may be widened to the narrowest legal integer covering
+  // it, as long as this stays within the bitfield representatives: bitfields
+  // in the same representative are considered a single memory location.
+  uint64_t RepLo = 0, RepHi = ~0ULL;
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    tree rep = DECL_BIT_FIELD_REPRESENTATIVE(
+        TREE_OPERAND(gimple_assign_lhs(Stores[i]), 1));
+    if (!rep || !OffsetIsLLVMCompatible(rep) ||
+        !isInt64(DECL_SIZE(rep), true)) {
+      RepHi = 0;
+      break;
+    }
+    uint64_t RepStart = getFieldOffsetInBits(rep);
+    RepLo = std::max(RepLo, RepStart / 8);
+    RepHi = std::min(RepHi, (RepStart + getInt64(DECL_SIZE(rep), true)) / 8);
+  }
+  for (uint64_t Size = NextPowerOf2(Bytes - 1); Size <= 8; Size *= 2) {
+    uint64_t Lo = Start - Start % Size;
+    if (!DL.isLegalInteger(Size * 8) || Lo + Size < Start + Bytes)
+      continue;
+    if (Lo >= RepLo && Lo + Size <= RepHi) {
+      Start = Lo;
+      Bytes = Size;
+    }
+    break;
+  }
+#endif
+
+  // Load the existing bits.
+  LValue Base = EmitLV(TREE_OPERAND(first, 0));
+  assert(!Base.isBitfield() && "Record is a bitfield!");
+  unsigned LoadSizeInBits = Bytes * 8;
+  Type *LoadType = IntegerType::get(Context, LoadSizeInBits);
+  Value *Ptr = Builder.CreateBitCast(Base.Ptr, Type::getInt8PtrTy(Context));
+  if (Start)
+    Ptr = Builder.CreateConstInBoundsGEP1_64(Ptr, Start);
+  Ptr = Builder.CreateBitCast(Ptr, LoadType->getPointerTo());
+  unsigned Alignment = MinAlign(Base.getAlignment(), Start);
+  Value *Val = Builder.CreateAlignedLoad(Ptr, Alignment);
+
+  // Replace the bits of each field in turn, so later stores win.
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    tree lhs = gimple_assign_lhs(Stores[i]);
+    tree field = TREE_OPERAND(lhs, 1);
+    unsigned BitStart = getFieldOffsetInBits(field) - Start * 8;
+    unsigned BitSize = getInt64(DECL_SIZE(field), true);
+    unsigned FirstBitInVal =
+        BYTES_BIG_ENDIAN ? LoadSizeInBits - BitStart - BitSize : BitStart;
+    APInt Mask = APInt::getBitsSet(LoadSizeInBits, FirstBitInVal,
+                                   FirstBitInVal + BitSize);
+
+    Value *RHS = EmitRegister(gimple_assign_rhs1(Stores[i]));
+    RHS = Builder.CreateIntCast(RHS, LoadType, !TYPE_UNSIGNED(TREE_TYPE(lhs)));
+    if (FirstBitInVal)
+      RHS = Builder.CreateShl(RHS, FirstBitInVal);
+    if (FirstBitInVal + BitSize != LoadSizeInBits)
+      RHS = Builder.CreateAnd(RHS, ConstantInt::get(Context, Mask));
+    Val = Builder.CreateAnd(Val, ConstantInt::get(Context, ~Mask));
+    Val = Builder.CreateOr(Val, RHS);
+  }
+
+  Builder.CreateAlignedStore(Val, Ptr, Alignment);
+}
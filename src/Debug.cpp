@@ -207,8 +207,40 @@ static StringRef getLinkageName(tree Node) {
 
 DebugInfo::DebugInfo(Module *m)
     : M(*m), VMContext(M.getContext()), Builder(M), DeclareFn(0),
-    ValueFn(0), CurFullPath(""), PrevFullPath(""), CurLineNo(0), PrevLineNo(0),
-    PrevBB(NULL) {}
+    ValueFn(0), LineTablesOnly(debug_info_level <= DINFO_LEVEL_TERSE),
+    CurLocation(UNKNOWN_LOCATION), CurFileID(0), PrevFileID(0), CurLineNo(0),
+    PrevLineNo(0), PrevBB(NULL) {}
+
+/// setLocation - Set the current source location.  Consecutive statements
+/// often share a location, so only expand it when it changes.
+void DebugInfo::setLocation(unsigned Loc) {
+  if (Loc == CurLocation)
+    return;
+  CurLocation = Loc;
+  if (Loc == UNKNOWN_LOCATION) {
+    CurFileID = 0;
+    CurLineNo = 0;
+    return;
+  }
+  expanded_location ELoc = expand_location(Loc);
+  CurFileID = getFileID(ELoc.file);
+  CurLineNo = ELoc.line;
+}
+
+/// getFileID - Intern the given file name.
+unsigned DebugInfo::getFileID(const char *FullPath) {
+  if (!FullPath || !FullPath[0])
+    return 0;
+  DenseMap<const char *, unsigned>::iterator I = FilePtrIDs.find(FullPath);
+  if (I != FilePtrIDs.end())
+    return I->second;
+  // Not seen at this address, but the same name may live elsewhere.
+  unsigned &ID = FileIDs[FullPath];
+  if (!ID)
+    ID = FileIDs.size();
+  FilePtrIDs[FullPath] = ID;
+  return ID;
+}
 
 /// getFunctionName - Get function name for the given FnDecl. If the
 /// name is constructred on demand (e.g. C++ destructor) then the name
@@ -231,7 +263,12 @@ StringRef DebugInfo::getFunctionName(tree FnDecl) {
 
 /// EmitFunctionStart - Constructs the debug code for entering a function.
 void DebugInfo::EmitFunctionStart(tree FnDecl, Function *Fn) {
-  DIType FNType = getOrCreateType(TREE_TYPE(FnDecl));
+  // With line tables only, describe every function as taking no arguments and
+  // place it at file scope, so no types or namespaces are ever output.
+  DIType FNType = LineTablesOnly ?
+      Builder.createSubroutineType(getOrCreateFile(main_input_filename),
+                                   Builder.getOrCreateTypeArray(None)) :
+      getOrCreateType(TREE_TYPE(FnDecl));
 
   unsigned lineno = CurLineNo;
 
@@ -263,8 +300,8 @@ void DebugInfo::EmitFunctionStart(tree FnDecl, Function *Fn) {
     ArtificialFnWithAbstractOrigin = true;
 
   DIDescriptor SPContext =
-      ArtificialFnWithAbstractOrigin ? getOrCreateFile(main_input_filename)
-                                     : findRegion(DECL_CONTEXT(FnDecl));
+      (ArtificialFnWithAbstractOrigin || LineTablesOnly) ?
+      getOrCreateFile(main_input_filename) : findRegion(DECL_CONTEXT(FnDecl));
 
   // Creating context may have triggered creation of this SP descriptor. So
   // check the cache again.
@@ -292,7 +329,7 @@ void DebugInfo::EmitFunctionStart(tree FnDecl, Function *Fn) {
   unsigned Virtuality = 0;
   unsigned VIndex = 0;
   DIType ContainingType;
-  if (DECL_VINDEX(FnDecl) && DECL_CONTEXT(FnDecl) &&
+  if (!LineTablesOnly && DECL_VINDEX(FnDecl) && DECL_CONTEXT(FnDecl) &&
       isa<TYPE>((DECL_CONTEXT(FnDecl)))) { // Workaround GCC PR42653
 #if (GCC_MINOR <= 8)    /* Condition added by Arun */
     if (host_integerp(DECL_VINDEX(FnDecl), 0))
@@ -386,7 +423,7 @@ void DebugInfo::EmitFunctionEnd(bool EndFunction) {
   if (EndFunction) {
     PrevBB = NULL;
     PrevLineNo = 0;
-    PrevFullPath = NULL;
+    PrevFileID = 0;
   }
 }
 
@@ -394,8 +431,9 @@ void DebugInfo::EmitFunctionEnd(bool EndFunction) {
 void DebugInfo::EmitDeclare(tree decl, unsigned Tag, StringRef Name, tree type,
                             Value *AI, LLVMBuilder &IRBuilder) {
 
-  // Ignore compiler generated temporaries.
-  if (DECL_IGNORED_P(decl))
+  // Ignore compiler generated temporaries, and all variables if only emitting
+  // line tables.
+  if (DECL_IGNORED_P(decl) || LineTablesOnly)
     return;
 
   assert(!RegionStack.empty() && "Region stack mismatch, stack empty!");
@@ -422,14 +460,13 @@ void DebugInfo::EmitDeclare(tree decl, unsigned Tag, StringRef Name, tree type,
 /// EmitStopPoint - Set current source location.
 void DebugInfo::EmitStopPoint(BasicBlock *CurBB, LLVMBuilder &Builder) {
   // Don't bother if things are the same as last time.
-  if (PrevLineNo == CurLineNo && PrevBB == CurBB &&
-      (PrevFullPath == CurFullPath || !strcmp(PrevFullPath, CurFullPath)))
+  if (PrevLineNo == CurLineNo && PrevBB == CurBB && PrevFileID == CurFileID)
     return;
-  if (!CurFullPath[0] || CurLineNo == 0)
+  if (!CurFileID || CurLineNo == 0)
     return;
 
   // Update last state.
-  PrevFullPath = CurFullPath;
+  PrevFileID = CurFileID;
   PrevLineNo = CurLineNo;
   PrevBB = CurBB;
 
@@ -442,7 +479,7 @@ void DebugInfo::EmitStopPoint(BasicBlock *CurBB, LLVMBuilder &Builder) {
 /// EmitGlobalVariable - Emit information about a global variable.
 ///
 void DebugInfo::EmitGlobalVariable(GlobalVariable *GV, tree decl) {
-  if (DECL_ARTIFICIAL(decl) || DECL_IGNORED_P(decl))
+  if (LineTablesOnly || DECL_ARTIFICIAL(decl) || DECL_IGNORED_P(decl))
     return;
   // Gather location information.
   expanded_location Loc = expand_location(DECL_SOURCE_LOCATION(decl));
@@ -1136,7 +1173,9 @@ void DebugInfo::getOrCreateCompileUnit(const char *FullPath, bool isMain) {
   //  if (flag_objc_abi != 0 && flag_objc_abi != -1)
   //    ObjcRunTimeVer = flag_objc_abi;
   Builder.createCompileUnit(LangTag, FileName, Directory, version_string,
-                            optimize, Flags, ObjcRunTimeVer);
+                            optimize, Flags, ObjcRunTimeVer, StringRef(),
+                            LineTablesOnly ? DIBuilder::LineTablesOnly :
+                                             DIBuilder::FullDebug);
 }
 
 /// getOrCreateFile - Get DIFile descriptor.
@@ -55,6 +55,78 @@ using namespace llvm;
 
 void DefaultABIClient::anchor() {}
 
+/// Replay - Invoke the recorded callbacks on the given client.
+void ABIPlan::Replay(const std::vector<Step> &Steps, DefaultABIClient &C) {
+  for (unsigned i = 0, e = Steps.size(); i != e; ++i) {
+    const Step &S = Steps[i];
+    switch (S.Kind) {
+    case Step::ScalarResult:
+      C.HandleScalarResult(S.Ty);
+      break;
+    case Step::AggregateResultAsScalar:
+      C.HandleAggregateResultAsScalar(S.Ty, S.Num);
+      break;
+    case Step::AggregateResultAsAggregate:
+      C.HandleAggregateResultAsAggregate(S.Ty);
+      break;
+    case Step::AggregateShadowResult:
+      C.HandleAggregateShadowResult(cast<PointerType>(S.Ty), S.RetPtr);
+      break;
+    case Step::ScalarShadowResult:
+      C.HandleScalarShadowResult(cast<PointerType>(S.Ty), S.RetPtr);
+      break;
+    case Step::ScalarArgument:
+      C.HandleScalarArgument(S.Ty, S.type, S.Num);
+      break;
+    case Step::ByInvisibleReferenceArgument:
+      C.HandleByInvisibleReferenceArgument(S.Ty, S.type);
+      break;
+    case Step::ByValArgument:
+      C.HandleByValArgument(S.Ty, S.type);
+      break;
+    case Step::FCAArgument:
+      C.HandleFCAArgument(S.Ty, S.type);
+      break;
+    case Step::EnterField:
+      C.EnterField(S.Num, S.Ty);
+      break;
+    case Step::ExitField:
+      C.ExitField();
+      break;
+    case Step::Pad:
+      C.HandlePad(S.Ty);
+      break;
+    }
+  }
+}
+
+/// ABIPlans - Recorded call lowerings, keyed on the callee (declaration or
+/// function type) and the function type.  Since the keys are trees, the cache
+/// is cleared whenever GCC garbage collects.
+static DenseMap<std::pair<tree, tree>, ABIPlan *> ABIPlans;
+
+ABIPlan *getCachedABIPlan(tree Fn, tree FnType) {
+  DenseMap<std::pair<tree, tree>, ABIPlan *>::iterator I =
+      ABIPlans.find(std::make_pair(Fn, FnType));
+  return I == ABIPlans.end() ? 0 : I->second;
+}
+
+void setCachedABIPlan(tree Fn, tree FnType, const ABIPlan &Plan) {
+  ABIPlan *&Slot = ABIPlans[std::make_pair(Fn, FnType)];
+  if (Slot)
+    *Slot = Plan;
+  else
+    Slot = new ABIPlan(Plan);
+}
+
+void clearABIPlanCache() {
+  for (DenseMap<std::pair<tree, tree>, ABIPlan *>::iterator
+           I = ABIPlans.begin(), E = ABIPlans.end();
+       I != E; ++I)
+    delete I->second;
+  ABIPlans.clear();
+}
+
 // doNotUseShadowReturn - Return true if the specified GCC type
 // should not be returned using a pointer to struct parameter.
 bool doNotUseShadowReturn(tree type, tree fndecl, CallingConv::ID CC) {
@@ -248,6 +320,14 @@ void DefaultABI::HandleArgument(tree type, std::vector<Type *> &ScalarElts,
         AttrBuilder->addAttribute(Attribute::ByVal);
         AttrBuilder->addAlignmentAttr(LLVM_BYVAL_ALIGNMENT(type));
       }
+      // Use up any registers the target says can no longer hold arguments.
+      std::vector<Type *> Pads;
+      LLVM_SPILLED_AGGREGATE_PADDING(Elts, ScalarElts, C.getCallingConv(),
+                                     Pads);
+      for (unsigned i = 0, e = Pads.size(); i != e; ++i) {
+        C.HandlePad(Pads[i]);
+        ScalarElts.push_back(Pads[i]);
+      }
     }
   } else if (LLVM_SHOULD_PASS_AGGREGATE_USING_BYVAL_ATTR(type, Ty)) {
     C.HandleByValArgument(Ty, type);
@@ -29,6 +29,7 @@
 
 // LLVM headers
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 
 // System headers
@@ -68,6 +69,13 @@ using namespace llvm;
 
 static LLVMContext &Context = getGlobalContext();
 
+#define DEBUG_TYPE "dragonegg"
+STATISTIC(NumNaturalRecords, "Number of records with a natural struct layout");
+STATISTIC(NumPaddedRecords, "Number of records needing explicit padding");
+STATISTIC(NumPackedRecords, "Number of records needing a packed struct");
+STATISTIC(NumTruncatedFields, "Number of record fields truncated to a prefix");
+STATISTIC(NumByteFields, "Number of record fields turned into bytes");
+
 /// SCCInProgress - Set of mutually dependent types currently being converted.
 static const std::vector<tree_node *> *SCCInProgress;
 
@@ -716,6 +724,8 @@ FunctionType *ConvertArgListToFnType(
     // Determine if there are any attributes for this param.
     AttrBuilder PAttrBuilder;
 
+    unsigned OldSize = ArgTys.size();
+
     ABIConverter.HandleArgument(ArgTy, ScalarArgs, &PAttrBuilder);
 
     // Compute zext/sext attributes.
@@ -725,17 +735,18 @@ FunctionType *ConvertArgListToFnType(
     if (isa<ACCESS_TYPE>(ArgTy) && TYPE_RESTRICT(ArgTy))
       PAttrBuilder.addAttribute(Attribute::NoAlias);
 
+    // The argument comes first, followed by any padding.
     if (PAttrBuilder.hasAttributes())
-      Attrs.push_back(AttributeSet::get(Context, ArgTys.size(), PAttrBuilder));
+      Attrs.push_back(AttributeSet::get(Context, OldSize + 1, PAttrBuilder));
   }
 
   PAL = AttributeSet::get(Context, Attrs);
   return FunctionType::get(RetTy, ArgTys, false);
 }
 
-FunctionType *
-ConvertFunctionType(tree type, tree decl, tree static_chain,
-                    CallingConv::ID &CallingConv, AttributeSet &PAL) {
+static FunctionType *
+ConvertFunctionTypeUncached(tree type, tree decl, tree static_chain,
+                            CallingConv::ID &CallingConv, AttributeSet &PAL) {
   Type *RetTy = Type::getVoidTy(Context);
   SmallVector<Type *, 8> ArgTypes;
   FunctionTypeConversion Client(RetTy, ArgTypes, CallingConv,
@@ -747,7 +758,11 @@ ConvertFunctionType(tree type, tree decl, tree static_chain,
   TARGET_ADJUST_LLVM_CC(CallingConv, type);
 #endif
 
-  ABIConverter.HandleReturnType(TREE_TYPE(type), current_function_decl,
+  // Whether the result is returned in memory may depend on the ABI of the
+  // function (ms_abi versus sysv_abi on x86-64), so ask about this function
+  // rather than the one being compiled.  This also keeps the conversion a
+  // function of the FunctionTypeCache key.
+  ABIConverter.HandleReturnType(TREE_TYPE(type), decl ? decl : type,
                                 decl ? DECL_BUILT_IN(decl) : false);
 
   // Compute attributes for return type (and function attributes).
@@ -887,8 +902,11 @@ ConvertFunctionType(tree type, tree decl, tree static_chain,
       HasByVal |= PAttrBuilder.contains(Attribute::ByVal);
 
       // If the argument is split into multiple scalars, assign the
-      // attributes to all scalars of the aggregate.
-      for (unsigned i = OldSize + 1; i <= ArgTypes.size(); ++i)
+      // attributes to all scalars of the aggregate.  A byval argument is one
+      // pointer, possibly followed by padding which gets no attributes.
+      unsigned Last = PAttrBuilder.contains(Attribute::ByVal) ?
+                      OldSize + 1 : ArgTypes.size();
+      for (unsigned i = OldSize + 1; i <= Last; ++i)
         Attrs.push_back(AttributeSet::get(Context, i, PAttrBuilder));
     }
 
@@ -916,6 +934,60 @@ ConvertFunctionType(tree type, tree decl, tree static_chain,
   return FunctionType::get(RetTy, ArgTypes, Args == 0);
 }
 
+namespace {
+/// FunctionTypeInfo - The result of converting a function type.
+struct FunctionTypeInfo {
+  FunctionType *FTy;
+  CallingConv::ID CallingConv;
+  AttributeSet PAL;
+};
+}
+
+/// FunctionTypeKey - What the conversion of a function type depends on: the
+/// type itself, the declaration if any, and the type of the static chain if
+/// any.
+typedef std::pair<std::pair<tree, tree>, tree> FunctionTypeKey;
+
+/// FunctionTypeCache - Memoized results of ConvertFunctionType.  Since it is
+/// keyed on trees it is cleared whenever GCC garbage collects.
+static DenseMap<FunctionTypeKey, FunctionTypeInfo> FunctionTypeCache;
+
+FunctionType *
+ConvertFunctionType(tree type, tree decl, tree static_chain,
+                    CallingConv::ID &CallingConv, AttributeSet &PAL) {
+  // Types converted while a strongly connected component is in progress may
+  // contain placeholder pointers, so do not remember them.
+  if (SCCInProgress) {
+    CallingConv = CallingConv::C;
+    return ConvertFunctionTypeUncached(type, decl, static_chain, CallingConv,
+                                       PAL);
+  }
+
+  FunctionTypeKey Key(std::make_pair(type, decl),
+                      static_chain ? TREE_TYPE(static_chain) : 0);
+  DenseMap<FunctionTypeKey, FunctionTypeInfo>::iterator I =
+      FunctionTypeCache.find(Key);
+  if (I != FunctionTypeCache.end()) {
+    CallingConv = I->second.CallingConv;
+    PAL = I->second.PAL;
+    return I->second.FTy;
+  }
+
+  CallingConv = CallingConv::C;
+  FunctionType *FTy =
+      ConvertFunctionTypeUncached(type, decl, static_chain, CallingConv, PAL);
+  FunctionTypeInfo &Info = FunctionTypeCache[Key];
+  Info.FTy = FTy;
+  Info.CallingConv = CallingConv;
+  Info.PAL = PAL;
+  return FTy;
+}
+
+void InvalidateFunctionTypeCaches() {
+  FunctionTypeCache.clear();
+  clearABIPlanCache();
+}
+
 static Type *ConvertPointerTypeRecursive(tree type) {
   // This is where self-recursion loops are broken, by not converting the type
   // pointed to if this would cause trouble (the pointer type is turned into
@@ -970,6 +1042,43 @@ static Type *ConvertPointerTypeRecursive(tree type) {
 
 typedef Range<uint64_t> BitRange;
 
+StructType *GetAggregatePrefix(Type *Ty, uint64_t Bytes,
+                               const DataLayout &DL) {
+  SmallVector<Type *, 8> Elts;
+  uint64_t Covered = 0; // Number of bytes covered by Elts.
+  if (StructType *STy = dyn_cast<StructType>(Ty)) {
+    if (STy->isOpaque())
+      return 0;
+    const StructLayout *SL = DL.getStructLayout(STy);
+    for (unsigned i = 0, e = STy->getNumElements(); i != e; ++i) {
+      Type *EltTy = STy->getElementType(i);
+      uint64_t Offset = SL->getElementOffset(i);
+      uint64_t End = Offset + DL.getTypeAllocSize(EltTy);
+      if (End > Bytes)
+        break;
+      // Explicitly pad out any gap left by the element's alignment.
+      if (Offset > Covered)
+        Elts.push_back(GetUnitType(Context, Offset - Covered));
+      Elts.push_back(EltTy);
+      Covered = End;
+    }
+  } else if (ArrayType *ATy = dyn_cast<ArrayType>(Ty)) {
+    Type *EltTy = ATy->getElementType();
+    uint64_t EltSize = DL.getTypeAllocSize(EltTy);
+    uint64_t NumElts =
+        EltSize ? std::min(Bytes / EltSize, ATy->getNumElements()) : 0;
+    if (NumElts) {
+      Elts.push_back(ArrayType::get(EltTy, NumElts));
+      Covered = NumElts * EltSize;
+    }
+  }
+  if (Elts.empty())
+    return 0;
+  if (Covered < Bytes)
+    Elts.push_back(GetUnitType(Context, Bytes - Covered));
+  return StructType::get(Context, Elts, /*isPacked*/ true);
+}
+
 /// TypedRange - A type that applies to a range of bits.  Any part of the type
 /// outside of the range is discarded.  The range may be bigger than the type
 /// in which case any extra bits have an undefined type.
@@ -985,6 +1094,7 @@ class TypedRange {
     assert((R.empty() || Ty) && "Need type when range not empty!");
   }
 
+public:
   /// isSafeToReturnContentsDirectly - Return whether the current value for the
   /// type properly represents the bits in the range and so can be handed to the
   /// user as is.
@@ -1007,7 +1117,6 @@ class TypedRange {
     return AllocBits <= R.getWidth();
   }
 
-public:
   /// get - Use the given type for the range [first, last).
   static TypedRange get(uint64_t first, uint64_t last, Type *Ty) {
     return TypedRange(BitRange(first, last), Ty, first);
@@ -1060,12 +1169,18 @@ public:
       if (isSafeToReturnContentsDirectly(DL))
         return Ty;
     }
+    // If the type is a struct or array that only needs to be truncated, which
+    // happens for example when the tail padding of a C++ base class is reused,
+    // then keep the leading elements so the optimizers can still see them.
+    uint64_t Units = R.getWidth() / BITS_PER_UNIT;
+    if (R.getFirst() == Starts)
+      if (Type *Prefix = GetAggregatePrefix(Ty, Units, DL)) {
+        Ty = Prefix;
+        assert(isSafeToReturnContentsDirectly(DL) && "Prefix too big!");
+        return Ty;
+      }
     // Represent the range using an array of bytes.  Remember the returned type
     // as an optimization in case we are called again.
-    // TODO: If the type only needs to be truncated and has struct or array type
-    // then we could try to do the truncation by dropping or modifying the last
-    // elements of the type, maybe yielding something less horrible.
-    uint64_t Units = R.getWidth() / BITS_PER_UNIT;
     Ty = GetUnitType(Context, Units);
     Starts = R.getFirst();
     assert(isSafeToReturnContentsDirectly(DL) && "Unit over aligned?");
@@ -1121,7 +1236,9 @@ static Type *ConvertRecordTypeRecursive(tree type) {
   // Process the fields in reverse order.  This is for the benefit of union
   // types since it means that a zero constant of the LLVM type will fully
   // initialize the first union member, which is needed if the zero constant
-  // is to be used as the default value for the union type.
+  // is to be used as the default value for the union type.  The ranges are
+  // added to the layout in one go once they have all been computed.
+  SmallVector<TypedRange, 16> FieldRanges;
   for (SmallVector<tree, 16>::reverse_iterator I = Fields.rbegin(),
                                                E = Fields.rend();
        I != E; ++I) {
@@ -1160,8 +1277,9 @@ static Type *ConvertRecordTypeRecursive(tree type) {
 
     // Set the type of the range of bits occupied by the field to the LLVM type
     // for the field.
-    Layout.AddInterval(TypedRange::get(FirstBit, LastBit, FieldTy));
+    FieldRanges.push_back(TypedRange::get(FirstBit, LastBit, FieldTy));
   }
+  Layout.AddIntervals(FieldRanges.begin(), FieldRanges.end());
 
   // Force all fields to begin and end on a byte boundary.  This automagically
   // takes care of bitfields.
@@ -1189,11 +1307,21 @@ static Type *ConvertRecordTypeRecursive(tree type) {
   std::vector<Type *> Elts;
   Elts.reserve(Layout.getNumIntervals());
   uint64_t EndOfPrevious = 0; // Offset of first bit after previous element.
+  bool Padded = false;        // Whether explicit padding was added.
+  unsigned MaxEltAlign = 1;   // The maximum alignment of the elements.
   for (unsigned i = 0, e = Layout.getNumIntervals(); i != e; ++i) {
     TypedRange F = Layout.getInterval(i);
     uint64_t First = F.getRange().getFirst();
+    bool isDirect = F.isSafeToReturnContentsDirectly(DL);
     Type *Ty = F.extractContents(DL);
     assert(EndOfPrevious <= First && "Previous field too big!");
+    if (!isDirect && !F.getRange().empty()) {
+      StructType *Prefix = dyn_cast<StructType>(Ty);
+      if (Prefix && Prefix->isLiteral())
+        ++NumTruncatedFields;
+      else if (!Ty->isIntegerTy())
+        ++NumByteFields;
+    }
 
     // If there is a gap then we may need to fill it with padding.
     if (First > EndOfPrevious) {
@@ -1214,23 +1342,36 @@ static Type *ConvertRecordTypeRecursive(tree type) {
                "Non-unit field boundaries!");
         uint64_t Units = (First - EndOfPrevious) / BITS_PER_UNIT;
         Elts.push_back(GetUnitType(Context, Units));
+        Padded = true;
       }
     }
 
     // Append the field.
     Elts.push_back(Ty);
     EndOfPrevious = First + DL.getTypeAllocSizeInBits(Ty);
+    MaxEltAlign = std::max(MaxEltAlign, DL.getABITypeAlignment(Ty));
   }
 
   // If the GCC type has a sensible size then we guarantee that LLVM type has
-  // the same size.  If needed, append padding to ensure this.
-  if (TypeSize != ~0UL && EndOfPrevious < TypeSize) {
+  // the same size.  If needed, append padding to ensure this.  There is no need
+  // if the tail padding of an ordinary struct already makes up the difference.
+  uint64_t NaturalEnd =
+      Pack ? EndOfPrevious : RoundUpToAlignment(EndOfPrevious, MaxEltAlign * 8);
+  if (TypeSize != ~0UL && EndOfPrevious < TypeSize && NaturalEnd != TypeSize) {
     assert((TypeSize - EndOfPrevious) % BITS_PER_UNIT == 0 &&
            "Non-unit type size?");
     uint64_t Units = (TypeSize - EndOfPrevious) / BITS_PER_UNIT;
     Elts.push_back(GetUnitType(Context, Units));
+    Padded = true;
   }
 
+  if (Pack)
+    ++NumPackedRecords;
+  else if (Padded)
+    ++NumPaddedRecords;
+  else
+    ++NumNaturalRecords;
+
   // OK, we're done.  Add the fields to the struct type and return it.
   Type *STy = getCachedType(type);
   assert(STy && isa<StructType>(STy) && cast<StructType>(STy)->isOpaque() &&
@@ -0,0 +1,363 @@
+//===-------------- Target.cpp - Implements the AArch64 ABI. --------------===//
+//
+// Copyright (C) 2013  Duncan Sands et al.
+//
+// This file is part of DragonEgg.
+//
+// DragonEgg is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2, or (at your option) any later version.
+//
+// DragonEgg is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// DragonEgg; see the file COPYING.  If not, write to the Free Software
+// Foundation, 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+//
+//===----------------------------------------------------------------------===//
+// This file implements the AArch64 procedure call standard (AAPCS64) and the
+// other AArch64 specific target hooks.
+//===----------------------------------------------------------------------===//
+
+// Plugin headers
+#include "dragonegg/ABI.h"
+#include "dragonegg/Target.h"
+
+// LLVM headers
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/IR/Module.h"
+
+// System headers
+#include <gmp.h>
+
+// GCC headers
+#include "auto-host.h"
+#ifndef ENABLE_BUILD_WITH_CXX
+#include <cstring> // Otherwise included by system.h with C linkage.
+extern "C" {
+#endif
+#include "config.h"
+// Stop GCC declaring 'getopt' as it can clash with the system's declaration.
+#undef HAVE_DECL_GETOPT
+#include "system.h"
+#include "coretypes.h"
+#include "target.h"
+#include "tree.h"
+
+#include "diagnostic.h"
+#include "toplev.h"
+#ifndef ENABLE_BUILD_WITH_CXX
+} // extern "C"
+#endif
+
+// Trees header.
+#include "dragonegg/Trees.h"
+
+static LLVMContext &Context = getGlobalContext();
+
+/// Number of general purpose (x0-x7) and SIMD/FP (v0-v7) registers used for
+/// passing arguments.
+static const unsigned NumArgRegs = 8;
+
+// MergeFundamentalType - Add Count members of the fundamental data type Ty to
+// a homogeneous aggregate candidate whose member type so far is Base.  Short
+// vectors of the same size are considered to be the same fundamental type.
+static bool MergeFundamentalType(Type *Ty, uint64_t Count, Type *&Base,
+                                 uint64_t &NumMembers) {
+  if (!Base)
+    Base = Ty;
+  else if (Base != Ty &&
+           !(Base->isVectorTy() && Ty->isVectorTy() &&
+             Base->getPrimitiveSizeInBits() == Ty->getPrimitiveSizeInBits()))
+    return false;
+  NumMembers += Count;
+  return true;
+}
+
+// ClassifyHomogeneous - Walk the GCC type, accumulating the number of members
+// of fundamental data type in NumMembers.  Returns false if the type contains
+// something other than floating point values and short vectors, or if more
+// than one fundamental data type is used.
+static bool ClassifyHomogeneous(tree type, Type *&Base, uint64_t &NumMembers) {
+  switch (TREE_CODE(type)) {
+  case REAL_TYPE:
+  case COMPLEX_TYPE: {
+    tree EltType = isa<COMPLEX_TYPE>(type) ? TREE_TYPE(type) : type;
+    if (!isa<REAL_TYPE>(EltType))
+      return false;
+    unsigned Precision = TYPE_PRECISION(EltType);
+    if (Precision != 32 && Precision != 64 && Precision != 128)
+      return false;
+    return MergeFundamentalType(ConvertType(EltType),
+                                isa<COMPLEX_TYPE>(type) ? 2 : 1, Base,
+                                NumMembers);
+  }
+
+  case VECTOR_TYPE: {
+    HOST_WIDE_INT Bytes = int_size_in_bytes(type);
+    if (Bytes != 8 && Bytes != 16)
+      return false;
+    return MergeFundamentalType(ConvertType(type), 1, Base, NumMembers);
+  }
+
+  case ARRAY_TYPE: {
+    HOST_WIDE_INT Bytes = int_size_in_bytes(type);
+    HOST_WIDE_INT EltBytes = int_size_in_bytes(TREE_TYPE(type));
+    if (Bytes < 0 || EltBytes <= 0)
+      return false;
+    uint64_t EltMembers = 0;
+    if (!ClassifyHomogeneous(TREE_TYPE(type), Base, EltMembers))
+      return false;
+    NumMembers += EltMembers * (Bytes / EltBytes);
+    return true;
+  }
+
+  case RECORD_TYPE:
+    // The fields of C++ base classes are included as artificial fields, so
+    // there is no need to look at the binfo.
+    for (tree Field = TYPE_FIELDS(type); Field; Field = TREE_CHAIN(Field)) {
+      if (!isa<FIELD_DECL>(Field) || TREE_TYPE(Field) == error_mark_node)
+        continue;
+      if (DECL_BIT_FIELD(Field) ||
+          !ClassifyHomogeneous(TREE_TYPE(Field), Base, NumMembers))
+        return false;
+    }
+    return true;
+
+  case UNION_TYPE:
+  case QUAL_UNION_TYPE: {
+    // A union has as many members as its largest field.
+    uint64_t MaxMembers = 0;
+    for (tree Field = TYPE_FIELDS(type); Field; Field = TREE_CHAIN(Field)) {
+      if (!isa<FIELD_DECL>(Field) || TREE_TYPE(Field) == error_mark_node)
+        continue;
+      uint64_t FieldMembers = 0;
+      if (DECL_BIT_FIELD(Field) ||
+          !ClassifyHomogeneous(TREE_TYPE(Field), Base, FieldMembers))
+        return false;
+      MaxMembers = std::max(MaxMembers, FieldMembers);
+    }
+    NumMembers += MaxMembers;
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+// isHomogeneousAggregate - Return true if the type is a homogeneous floating
+// point aggregate (HFA) or homogeneous short vector aggregate (HVA) as defined
+// in section 4.3.5 of the AAPCS64: a composite of one to four members that all
+// have the same fundamental data type, and no padding.  Such aggregates are
+// passed and returned in consecutive SIMD/FP registers.  On success the LLVM
+// type of the members is returned in Base and their number in Count.
+static bool isHomogeneousAggregate(tree type, Type *&Base, unsigned &Count) {
+  if (!isa<AGGREGATE_TYPE>(type) && !isa<COMPLEX_TYPE>(type))
+    return false;
+  if (TREE_ADDRESSABLE(type))
+    return false;
+  HOST_WIDE_INT Bytes = int_size_in_bytes(type);
+  if (Bytes <= 0)
+    return false;
+
+  Base = 0;
+  uint64_t NumMembers = 0;
+  if (!ClassifyHomogeneous(type, Base, NumMembers) || !Base ||
+      NumMembers < 1 || NumMembers > 4)
+    return false;
+  // Members must be laid out back to back.
+  if ((uint64_t) Bytes != NumMembers * getDataLayout().getTypeAllocSize(Base))
+    return false;
+
+  Count = NumMembers;
+  return true;
+}
+
+// count_num_registers_uses - Simulate the allocation of the general purpose
+// (NGRN) and SIMD/FP (NSRN) argument registers for the scalars in ScalarElts,
+// as described in section 5.4.2 of the AAPCS64.
+static void count_num_registers_uses(std::vector<Type *> &ScalarElts,
+                                     unsigned &NGRN, unsigned &NSRN) {
+  for (unsigned i = 0, e = ScalarElts.size(); i != e; ++i) {
+    Type *Ty = ScalarElts[i];
+    if (Ty->isFloatingPointTy()) {
+      ++NSRN;
+    } else if (Ty->isVectorTy()) {
+      // Vectors wider than 128 bits are split over several registers.
+      NSRN += std::max(1U, (Ty->getPrimitiveSizeInBits() + 127) / 128);
+    } else if (Ty->isPointerTy()) {
+      ++NGRN;
+    } else if (Ty->isIntegerTy()) {
+      unsigned Bits = Ty->getPrimitiveSizeInBits();
+      // Quadword integers start at an even numbered register.
+      if (Bits > 64)
+        NGRN = (NGRN + 1) & ~1U;
+      NGRN += (Bits + 63) / 64;
+    }
+  }
+}
+
+// Target hook for llvm-abi.h.  Composite types larger than 16 bytes that are
+// not homogeneous aggregates are passed by reference to a copy made by the
+// caller (AAPCS64 rule B.3).
+bool llvm_aarch64_try_pass_aggregate_custom(
+    tree type, std::vector<Type *> &ScalarElts, CallingConv::ID CC,
+    struct DefaultABIClient *C) {
+  (void) CC;
+  if (!isa<AGGREGATE_TYPE>(type) && !isa<COMPLEX_TYPE>(type))
+    return false;
+  if (int_size_in_bytes(type) <= 16)
+    return false;
+
+  Type *Base;
+  unsigned Count;
+  if (isHomogeneousAggregate(type, Base, Count))
+    return false;
+
+  Type *PtrTy = ConvertType(type)->getPointerTo();
+  C->HandleByInvisibleReferenceArgument(PtrTy, type);
+  ScalarElts.push_back(PtrTy);
+  return true;
+}
+
+// Target hook for llvm-abi.h.  It returns true if an aggregate of the
+// specified type should be passed in a number of registers of mixed types.
+// It also returns a vector of types that correspond to the registers used
+// for parameter passing.  Homogeneous aggregates use one SIMD/FP register
+// per member; any other composite of at most 16 bytes is passed in general
+// purpose registers, 16 byte aligned ones starting at an even register.
+bool llvm_aarch64_should_pass_aggregate_in_mixed_regs(
+    tree TreeType, Type *Ty, CallingConv::ID CC, std::vector<Type *> &Elts) {
+  (void) Ty;
+  (void) CC;
+  Type *Base;
+  unsigned Count;
+  if (isHomogeneousAggregate(TreeType, Base, Count)) {
+    Elts.insert(Elts.end(), Count, Base);
+    return true;
+  }
+
+  HOST_WIDE_INT Bytes = int_size_in_bytes(TreeType);
+  if (Bytes <= 0 || Bytes > 16)
+    return false;
+
+  if (TYPE_ALIGN(TreeType) >= 128)
+    Elts.push_back(IntegerType::get(Context, 128));
+  else
+    Elts.insert(Elts.end(), (Bytes + 7) / 8, Type::getInt64Ty(Context));
+  return true;
+}
+
+// Target hook for llvm-abi.h.  This is called when an aggregate is being
+// passed in registers.  AAPCS64 never splits a composite between registers and
+// the stack: if there are not enough registers left for all of it, return true
+// so that the whole aggregate is passed in memory instead.
+bool llvm_aarch64_aggregate_partially_passed_in_regs(
+    std::vector<Type *> &Elts, std::vector<Type *> &ScalarElts,
+    CallingConv::ID CC) {
+  (void) CC;
+  unsigned NGRN = 0, NSRN = 0;
+  count_num_registers_uses(ScalarElts, NGRN, NSRN);
+
+  unsigned OldNGRN = NGRN, OldNSRN = NSRN;
+  count_num_registers_uses(Elts, NGRN, NSRN);
+
+  return (NGRN != OldNGRN && NGRN > NumArgRegs) ||
+         (NSRN != OldNSRN && NSRN > NumArgRegs);
+}
+
+// Target hook for llvm-abi.h.  When a composite that would have been passed in
+// registers goes on the stack instead, the AAPCS64 sets NSRN (rule C.3, for
+// homogeneous aggregates) or NGRN (rule C.11, for the others) to 8, so later
+// arguments of that class go on the stack too.  Mark the registers that are
+// still free as used by passing padding in them.
+void llvm_aarch64_spilled_aggregate_padding(
+    std::vector<Type *> &Elts, std::vector<Type *> &ScalarElts,
+    CallingConv::ID CC, std::vector<Type *> &Pads) {
+  (void) CC;
+  unsigned NGRN = 0, NSRN = 0;
+  count_num_registers_uses(ScalarElts, NGRN, NSRN);
+
+  unsigned OldNGRN = NGRN, OldNSRN = NSRN;
+  count_num_registers_uses(Elts, NGRN, NSRN);
+
+  if (NSRN != OldNSRN)
+    for (unsigned i = OldNSRN; i < NumArgRegs; ++i)
+      Pads.push_back(Type::getDoubleTy(Context));
+  if (NGRN != OldNGRN)
+    for (unsigned i = OldNGRN; i < NumArgRegs; ++i)
+      Pads.push_back(Type::getInt64Ty(Context));
+}
+
+// Return LLVM Type if TYPE can be returned as an aggregate, otherwise return
+// NULL.  Homogeneous aggregates are returned in v0-v3, one member per
+// register; other small composites are returned as an integer in x0/x1.
+Type *llvm_aarch64_aggr_type_for_struct_return(tree TreeType,
+                                               CallingConv::ID CC) {
+  (void) CC;
+  Type *Base;
+  unsigned Count;
+  if (!isHomogeneousAggregate(TreeType, Base, Count))
+    return NULL;
+
+  std::vector<Type *> Elts(Count, Base);
+  return StructType::get(Context, Elts, false);
+}
+
+// llvm_aarch64_extract_multiple_return_value - Extract the members of a
+// homogeneous aggregate returned in SRC and store them in DEST.  Since a
+// homogeneous aggregate has no padding its members are laid out exactly as
+// the returned struct.
+void llvm_aarch64_extract_multiple_return_value(
+    Value *Src, Value *Dest, bool isVolatile, LLVMBuilder &Builder) {
+  StructType *STy = cast<StructType>(Src->getType());
+  Dest = Builder.CreateBitCast(Dest, STy->getPointerTo());
+  for (unsigned i = 0, e = STy->getNumElements(); i != e; ++i) {
+    Value *EVI = Builder.CreateExtractValue(Src, i, "mrv_gr");
+    Value *GEP = Builder.CreateStructGEP(Dest, i, "mrv_gep");
+    Builder.CreateAlignedStore(EVI, GEP, 1, isVolatile);
+  }
+}
+
+// Target hook for llvm-abi.h for LLVM_SHOULD_NOT_USE_SHADOW_RETURN.  Returns
+// true if the aggregate is returned in registers: homogeneous aggregates and
+// composites of at most 16 bytes.  Everything else is returned in memory
+// pointed to by x8.
+bool llvm_aarch64_should_return_aggregate_in_regs(tree TreeType,
+                                                  CallingConv::ID CC) {
+  (void) CC;
+  Type *Base;
+  unsigned Count;
+  if (isHomogeneousAggregate(TreeType, Base, Count))
+    return true;
+  HOST_WIDE_INT Bytes = int_size_in_bytes(TreeType);
+  return Bytes >= 0 && Bytes <= 16 && !TREE_ADDRESSABLE(TreeType);
+}
+
+static void addFeature(llvm::SubtargetFeatures &F, const char *Feature,
+                       bool Enabled) {
+  const char *Prefix = Enabled ? "+" : "-";
+  F.AddFeature(std::string(Prefix) + Feature);
+}
+
+void llvm_aarch64_set_subtarget_features(std::string &C,
+                                         llvm::SubtargetFeatures &F) {
+  // The -mcpu string may carry feature modifiers, as in cortex-a53+crypto.
+  // These have already been folded into the ISA flags tested below.
+  C = aarch64_cpu_string ? aarch64_cpu_string : "";
+  C = C.substr(0, C.find('+'));
+  if (C.empty())
+    C = "generic";
+
+  addFeature(F, "fp-armv8", TARGET_FLOAT);
+  addFeature(F, "neon", TARGET_SIMD);
+#ifdef TARGET_CRYPTO
+  addFeature(F, "crypto", TARGET_CRYPTO);
+#endif
+#ifdef TARGET_CRC32
+  addFeature(F, "crc", TARGET_CRC32);
+#endif
+}
@@ -592,3 +592,556 @@ bool llvm_arm_should_pass_or_return_aggregate_in_regs(tree TreeType,
                                            fdt_counts);
   return result && !TREE_ADDRESSABLE(TreeType);
 }
+
+//===----------------------------------------------------------------------===//
+//                       ... NEON Builtin Expansion ...
+//===----------------------------------------------------------------------===//
+
+/// BuiltinCode - A enumerated type with one value for each supported NEON
+/// builtin.
+enum BuiltinCode {
+  SearchForHandler, // Builtin not seen before - search for a handler.
+#define DEFINE_BUILTIN(x) x
+#include "neon_builtins"
+#undef DEFINE_BUILTIN
+  ,
+  UnsupportedBuiltin // There is no handler for this builtin.
+};
+
+struct HandlerEntry {
+  const char *Name;
+  BuiltinCode Handler;
+};
+
+static bool HandlerLT(const HandlerEntry &E, const HandlerEntry &F) {
+  return strcmp(E.Name, F.Name) < 0;
+}
+
+/// NeonModeEntry - Describes the vector type corresponding to the machine
+/// mode suffix used in the names of the NEON builtins.
+struct NeonModeEntry {
+  const char *Suffix;
+  unsigned EltBits;
+  bool isFloat;
+  unsigned NumElts;
+};
+
+// Vector modes come first so that, for example, "v2di" is matched before "di".
+static const NeonModeEntry NeonModes[] = {
+  { "v16qi", 8, false, 16 }, { "v8qi", 8, false, 8 },
+  { "v8hi", 16, false, 8 },  { "v4hi", 16, false, 4 },
+  { "v4si", 32, false, 4 },  { "v2si", 32, false, 2 },
+  { "v4sf", 32, true, 4 },   { "v2sf", 32, true, 2 },
+  { "v2di", 64, false, 2 },  { "di", 64, false, 1 }
+};
+
+/// GetNeonMode - Return the mode suffix at the end of the given builtin name,
+/// or null if the name does not end with a known NEON mode.
+static const NeonModeEntry *GetNeonMode(StringRef Name) {
+  for (unsigned i = 0, e = array_lengthof(NeonModes); i != e; ++i)
+    if (Name.endswith(NeonModes[i].Suffix))
+      return &NeonModes[i];
+  return 0;
+}
+
+/// GetNeonVectorType - Return the vector type operated on by the NEON builtin
+/// with the given name, or null if the name does not end with a known mode.
+static VectorType *GetNeonVectorType(StringRef Name) {
+  const NeonModeEntry *Mode = GetNeonMode(Name);
+  if (!Mode)
+    return 0;
+  Type *EltTy = Mode->isFloat ? Type::getFloatTy(Context) :
+                IntegerType::get(Context, Mode->EltBits);
+  return VectorType::get(EltTy, Mode->NumElts);
+}
+
+/// GetNeonMagicWord - Most NEON builtins take a final constant operand, the
+/// "magic word", describing the flavour of the operation: bit 0 is set for
+/// signed operations, bit 1 for polynomial ones (both for floating point) and
+/// bit 2 for rounding ones.  Returns false if the operand is not a constant.
+static bool GetNeonMagicWord(Value *Op, unsigned &Magic) {
+  ConstantInt *CI = llvm::dyn_cast<ConstantInt>(Op);
+  if (!CI)
+    return false;
+  Magic = CI->getZExtValue();
+  return true;
+}
+
+/// GetShuffleMask - Turn a list of element indices into a shufflevector mask.
+static Constant *GetShuffleMask(ArrayRef<unsigned> Idxs) {
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0, e = Idxs.size(); i != e; ++i)
+    Mask.push_back(ConstantInt::get(Type::getInt32Ty(Context), Idxs[i]));
+  return ConstantVector::get(Mask);
+}
+
+/* TargetIntrinsicLower - For builtins that we want to expand to normal LLVM
+ * code, emit the code now.  If we can handle the code, this macro should emit
+ * the code, return true.
+ */
+bool TreeToLLVM::TargetIntrinsicLower(
+    gimple stmt, tree fndecl, const MemRef */*DestLoc*/, Value *&Result,
+    Type *ResultType, std::vector<Value *> &Ops) {
+  // As on x86, the enumerated type of the ARM builtin codes is not visible to
+  // us, so map DECL_FUNCTION_CODE values to BuiltinCode values at run-time
+  // based on the name of the builtin.
+  static std::vector<BuiltinCode> FunctionCodeMap;
+  if (FunctionCodeMap.size() <= DECL_FUNCTION_CODE(fndecl))
+    FunctionCodeMap.resize(DECL_FUNCTION_CODE(fndecl) + 1);
+
+  const char *Identifier = IDENTIFIER_POINTER(DECL_NAME(fndecl));
+
+  // See if we already associated a BuiltinCode with this DECL_FUNCTION_CODE.
+  BuiltinCode &Handler = FunctionCodeMap[DECL_FUNCTION_CODE(fndecl)];
+  if (Handler == SearchForHandler) {
+    // List of builtin names and associated BuiltinCode.
+    static const HandlerEntry Handlers[] = {
+#define DEFINE_BUILTIN(x)                                                      \
+  { #x, x }
+#include "neon_builtins"
+#undef DEFINE_BUILTIN
+    };
+    size_t N = sizeof(Handlers) / sizeof(Handlers[0]);
+#ifndef NDEBUG
+    // Check that the list of handlers is sorted by name.
+    static bool Checked = false;
+    if (!Checked) {
+      for (unsigned i = 1; i < N; ++i)
+        assert(HandlerLT(Handlers[i - 1], Handlers[i]) &&
+               "Handlers not sorted!");
+      Checked = true;
+    }
+#endif
+
+    Handler = UnsupportedBuiltin;
+    StringRef Name(Identifier);
+    const NeonModeEntry *Mode = GetNeonMode(Name);
+    if (Name.startswith("__builtin_neon_") && Mode) {
+      // Strip off the prefix and the mode to get the name of the operation.
+      // The reinterpret builtins have two modes in their name, for example
+      // __builtin_neon_vreinterpretv8qiv4hi.
+      Name = Name.drop_front(strlen("__builtin_neon_"));
+      Name = Name.drop_back(strlen(Mode->Suffix));
+      if (Name.startswith("vreinterpret"))
+        Name = "vreinterpret";
+      std::string OpName = Name.str();
+      HandlerEntry ToFind = { OpName.c_str(), SearchForHandler };
+      const HandlerEntry *E =
+          std::lower_bound(Handlers, Handlers + N, ToFind, HandlerLT);
+      if ((E < Handlers + N) && !strcmp(E->Name, ToFind.Name))
+        Handler = E->Handler;
+    }
+  }
+
+  unsigned Magic = 0;
+
+  switch (Handler) {
+  case SearchForHandler:
+    llvm_unreachable("Unexpected builtin code!");
+  case UnsupportedBuiltin:
+    return false;
+  case vadd:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    Result = Ops[0]->getType()->isFPOrFPVectorTy() ?
+             Builder.CreateFAdd(Ops[0], Ops[1]) :
+             Builder.CreateAdd(Ops[0], Ops[1]);
+    return true;
+  case vsub:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    Result = Ops[0]->getType()->isFPOrFPVectorTy() ?
+             Builder.CreateFSub(Ops[0], Ops[1]) :
+             Builder.CreateSub(Ops[0], Ops[1]);
+    return true;
+  case vmul:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    if (Ops[0]->getType()->isFPOrFPVectorTy()) {
+      Result = Builder.CreateFMul(Ops[0], Ops[1]);
+    } else if (Magic & 2) {
+      // Polynomial multiplication has no IR equivalent.
+      Function *vmulp = Intrinsic::getDeclaration(
+          TheModule, Intrinsic::arm_neon_vmulp, Ops[0]->getType());
+      Result = Builder.CreateCall2(vmulp, Ops[0], Ops[1]);
+    } else {
+      Result = Builder.CreateMul(Ops[0], Ops[1]);
+    }
+    return true;
+  case vmla:
+  case vmls: {
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    bool isFP = Ops[0]->getType()->isFPOrFPVectorTy();
+    Value *Mul = isFP ? Builder.CreateFMul(Ops[1], Ops[2]) :
+                 Builder.CreateMul(Ops[1], Ops[2]);
+    if (Handler == vmla)
+      Result = isFP ? Builder.CreateFAdd(Ops[0], Mul) :
+               Builder.CreateAdd(Ops[0], Mul);
+    else
+      Result = isFP ? Builder.CreateFSub(Ops[0], Mul) :
+               Builder.CreateSub(Ops[0], Mul);
+    return true;
+  }
+  case vand:
+    Result = Builder.CreateAnd(Ops[0], Ops[1]);
+    return true;
+  case vorr:
+    Result = Builder.CreateOr(Ops[0], Ops[1]);
+    return true;
+  case veor:
+    Result = Builder.CreateXor(Ops[0], Ops[1]);
+    return true;
+  case vbic:
+    Result = Builder.CreateAnd(Ops[0], Builder.CreateNot(Ops[1]));
+    return true;
+  case vorn:
+    Result = Builder.CreateOr(Ops[0], Builder.CreateNot(Ops[1]));
+    return true;
+  case vmvn:
+    Result = Builder.CreateNot(Ops[0]);
+    return true;
+  case vneg:
+    Result = Ops[0]->getType()->isFPOrFPVectorTy() ?
+             Builder.CreateFNeg(Ops[0]) : Builder.CreateNeg(Ops[0]);
+    return true;
+  case vabs:
+    if (Ops[0]->getType()->isFPOrFPVectorTy()) {
+      Function *fabs = Intrinsic::getDeclaration(TheModule, Intrinsic::fabs,
+                                                 Ops[0]->getType());
+      Result = Builder.CreateCall(fabs, Ops[0]);
+    } else {
+      Value *Zero = Constant::getNullValue(Ops[0]->getType());
+      Value *IsNeg = Builder.CreateICmpSLT(Ops[0], Zero);
+      Result = Builder.CreateSelect(IsNeg, Builder.CreateNeg(Ops[0]), Ops[0]);
+    }
+    return true;
+  case vceq:
+  case vcge:
+  case vcgt:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    if (Ops[0]->getType()->isFPOrFPVectorTy()) {
+      if (Handler == vceq)
+        Result = Builder.CreateFCmpOEQ(Ops[0], Ops[1]);
+      else if (Handler == vcge)
+        Result = Builder.CreateFCmpOGE(Ops[0], Ops[1]);
+      else
+        Result = Builder.CreateFCmpOGT(Ops[0], Ops[1]);
+    } else if (Handler == vceq) {
+      Result = Builder.CreateICmpEQ(Ops[0], Ops[1]);
+    } else if (Handler == vcge) {
+      Result = (Magic & 1) ? Builder.CreateICmpSGE(Ops[0], Ops[1]) :
+               Builder.CreateICmpUGE(Ops[0], Ops[1]);
+    } else {
+      Result = (Magic & 1) ? Builder.CreateICmpSGT(Ops[0], Ops[1]) :
+               Builder.CreateICmpUGT(Ops[0], Ops[1]);
+    }
+    // Need to sign extend since fcmp and icmp return a vector of i1.
+    Result = Builder.CreateSExt(Result, ResultType);
+    return true;
+  case vmax:
+  case vmin:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    if (Ops[0]->getType()->isFPOrFPVectorTy()) {
+      // The NEON semantics for NaNs differ from those of fcmp and select.
+      Function *F = Intrinsic::getDeclaration(
+          TheModule, Handler == vmax ? Intrinsic::arm_neon_vmaxs :
+                     Intrinsic::arm_neon_vmins, Ops[0]->getType());
+      Result = Builder.CreateCall2(F, Ops[0], Ops[1]);
+    } else {
+      Value *Cmp = (Magic & 1) ? Builder.CreateICmpSGT(Ops[0], Ops[1]) :
+                   Builder.CreateICmpUGT(Ops[0], Ops[1]);
+      Result = Handler == vmax ? Builder.CreateSelect(Cmp, Ops[0], Ops[1]) :
+               Builder.CreateSelect(Cmp, Ops[1], Ops[0]);
+    }
+    return true;
+  case vshl_n:
+  case vshr_n: {
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    // Rounding shifts have no IR equivalent.
+    if (Magic & 4)
+      return false;
+    ConstantInt *Amt = llvm::dyn_cast<ConstantInt>(Ops[1]);
+    if (!Amt) {
+      error_at(gimple_location(stmt), "shift amount must be an immediate");
+      Result = Ops[0];
+      return true;
+    }
+    // Right shifts may be by the full element width, which is undefined for
+    // the IR shifts: the result is zero, or the sign bit for signed shifts.
+    Type *Ty = Ops[0]->getType();
+    uint64_t Shift = Amt->getZExtValue();
+    bool isFullWidth = Handler == vshr_n &&
+                       Shift == Ty->getScalarSizeInBits();
+    if (isFullWidth && !(Magic & 1)) {
+      Result = Constant::getNullValue(Ty);
+      return true;
+    }
+    if (isFullWidth)
+      --Shift;
+    Value *Splat = ConstantInt::get(Ty, Shift);
+    if (Handler == vshl_n)
+      Result = Builder.CreateShl(Ops[0], Splat);
+    else
+      Result = (Magic & 1) ? Builder.CreateAShr(Ops[0], Splat) :
+               Builder.CreateLShr(Ops[0], Splat);
+    return true;
+  }
+  case vmovl:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    Result = (Magic & 1) ? Builder.CreateSExt(Ops[0], ResultType) :
+             Builder.CreateZExt(Ops[0], ResultType);
+    return true;
+  case vmovn:
+    Result = Builder.CreateTrunc(Ops[0], ResultType);
+    return true;
+  case vcvt:
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    if (Ops[0]->getType()->isFPOrFPVectorTy())
+      Result = (Magic & 1) ? Builder.CreateFPToSI(Ops[0], ResultType) :
+               Builder.CreateFPToUI(Ops[0], ResultType);
+    else
+      Result = (Magic & 1) ? Builder.CreateSIToFP(Ops[0], ResultType) :
+               Builder.CreateUIToFP(Ops[0], ResultType);
+    return true;
+  case vreinterpret:
+    Result = Builder.CreateBitCast(Ops[0], ResultType);
+    return true;
+  // In the DImode ("di") forms the 64 bit vector of one element is a plain i64
+  // rather than a vector, so these operations reduce to scalar ones.
+  case vdup_n:
+  case vmov_n: {
+    Value *Elt = Ops[0];
+    VectorType *VecTy = llvm::dyn_cast<VectorType>(ResultType);
+    // The scalar operand is sometimes promoted to int.
+    if (Elt->getType()->isIntegerTy())
+      Elt = Builder.CreateIntCast(Elt, ResultType->getScalarType(),
+                                  /*isSigned*/ false);
+    Result = VecTy ? Builder.CreateVectorSplat(VecTy->getNumElements(), Elt) :
+             Elt;
+    return true;
+  }
+  case vdup_lane: {
+    ConstantInt *Lane = llvm::dyn_cast<ConstantInt>(Ops[1]);
+    if (!Lane) {
+      error_at(gimple_location(stmt), "lane number must be an immediate");
+      Result = UndefValue::get(ResultType);
+      return true;
+    }
+    VectorType *VecTy = llvm::dyn_cast<VectorType>(ResultType);
+    if (!Ops[0]->getType()->isVectorTy()) {
+      Result = VecTy ?
+               Builder.CreateVectorSplat(VecTy->getNumElements(), Ops[0]) :
+               Ops[0];
+      return true;
+    }
+    if (!VecTy)
+      return false;
+    SmallVector<unsigned, 16> Idxs(VecTy->getNumElements(),
+                                   Lane->getZExtValue());
+    Result = Builder.CreateShuffleVector(
+        Ops[0], UndefValue::get(Ops[0]->getType()), GetShuffleMask(Idxs));
+    return true;
+  }
+  case vget_lane: {
+    if (!GetNeonMagicWord(Ops.back(), Magic))
+      return false;
+    Result = Ops[0]->getType()->isVectorTy() ?
+             Builder.CreateExtractElement(Ops[0], Ops[1]) : Ops[0];
+    if (ResultType->isIntegerTy())
+      Result = Builder.CreateIntCast(Result, ResultType, Magic & 1);
+    return true;
+  }
+  case vset_lane: {
+    Type *EltTy = Ops[1]->getType()->getScalarType();
+    Value *Elt = Ops[0];
+    if (Elt->getType()->isIntegerTy())
+      Elt = Builder.CreateIntCast(Elt, EltTy, /*isSigned*/ false);
+    Result = Ops[1]->getType()->isVectorTy() ?
+             Builder.CreateInsertElement(Ops[1], Elt, Ops[2]) : Elt;
+    return true;
+  }
+  case vcombine: {
+    if (!Ops[0]->getType()->isVectorTy()) {
+      if (!ResultType->isVectorTy())
+        return false;
+      Result = UndefValue::get(ResultType);
+      Result = Builder.CreateInsertElement(Result, Ops[0], Builder.getInt32(0));
+      Result = Builder.CreateInsertElement(Result, Ops[1], Builder.getInt32(1));
+      return true;
+    }
+    unsigned NumElts = cast<VectorType>(Ops[0]->getType())->getNumElements();
+    SmallVector<unsigned, 16> Idxs;
+    for (unsigned i = 0; i != 2 * NumElts; ++i)
+      Idxs.push_back(i);
+    Result = Builder.CreateShuffleVector(Ops[0], Ops[1], GetShuffleMask(Idxs));
+    return true;
+  }
+  case vget_high:
+  case vget_low:
+    if (!Ops[0]->getType()->isVectorTy())
+      return false;
+    if (!ResultType->isVectorTy()) {
+      // Splitting a v2di gives a DImode value.
+      Result = Builder.CreateExtractElement(
+          Ops[0], Builder.getInt32(Handler == vget_high));
+      return true;
+    }
+    Result = Handler == vget_high ? VectorHighElements(Ops[0]) :
+             VectorLowElements(Ops[0]);
+    return true;
+  case vext: {
+    ConstantInt *Shift = llvm::dyn_cast<ConstantInt>(Ops[2]);
+    if (!Shift) {
+      error_at(gimple_location(stmt), "mask must be an immediate");
+      Result = Ops[0];
+      return true;
+    }
+    // Only a shift of zero is allowed for the DImode form.
+    if (!Ops[0]->getType()->isVectorTy()) {
+      Result = Ops[0];
+      return true;
+    }
+    unsigned NumElts = cast<VectorType>(Ops[0]->getType())->getNumElements();
+    SmallVector<unsigned, 16> Idxs;
+    for (unsigned i = 0; i != NumElts; ++i)
+      Idxs.push_back(Shift->getZExtValue() + i);
+    Result = Builder.CreateShuffleVector(Ops[0], Ops[1], GetShuffleMask(Idxs));
+    return true;
+  }
+  case vrev16:
+  case vrev32:
+  case vrev64: {
+    // Reverse the order of the elements within each 16, 32 or 64 bit chunk.
+    VectorType *VecTy = llvm::dyn_cast<VectorType>(Ops[0]->getType());
+    if (!VecTy)
+      return false;
+    unsigned ChunkBits = Handler == vrev16 ? 16 : Handler == vrev32 ? 32 : 64;
+    unsigned EltsPerChunk = ChunkBits / VecTy->getScalarSizeInBits();
+    if (!EltsPerChunk)
+      return false;
+    SmallVector<unsigned, 16> Idxs;
+    for (unsigned i = 0, e = VecTy->getNumElements(); i != e; ++i)
+      Idxs.push_back((i / EltsPerChunk) * EltsPerChunk + EltsPerChunk - 1 -
+                     i % EltsPerChunk);
+    Result = Builder.CreateShuffleVector(Ops[0], UndefValue::get(VecTy),
+                                         GetShuffleMask(Idxs));
+    return true;
+  }
+  case vzip:
+  case vuzp:
+  case vtrn: {
+    // These produce a pair of vectors, stored to the pointer operand.
+    VectorType *VecTy = llvm::dyn_cast<VectorType>(Ops[1]->getType());
+    if (!VecTy)
+      return false;
+    unsigned NumElts = VecTy->getNumElements();
+    Value *Ptr = Builder.CreateBitCast(Ops[0], VecTy->getPointerTo());
+    for (unsigned Part = 0; Part != 2; ++Part) {
+      SmallVector<unsigned, 16> Idxs;
+      for (unsigned i = 0; i != NumElts; ++i)
+        if (Handler == vzip)
+          Idxs.push_back((i & 1 ? NumElts : 0) + (Part * NumElts + i) / 2);
+        else if (Handler == vuzp)
+          Idxs.push_back(2 * i + Part);
+        else
+          Idxs.push_back((i & 1 ? NumElts : 0) + (i & ~1U) + Part);
+      Value *V =
+          Builder.CreateShuffleVector(Ops[1], Ops[2], GetShuffleMask(Idxs));
+      Builder.CreateStore(V, Builder.CreateConstInBoundsGEP1_32(Ptr, Part));
+    }
+    return true;
+  }
+  case vld1: {
+    // Only element alignment is required.
+    Value *Ptr = Builder.CreateBitCast(Ops[0], ResultType->getPointerTo());
+    Result = Builder.CreateAlignedLoad(Ptr,
+                                       ResultType->getScalarSizeInBits() / 8);
+    return true;
+  }
+  case vld1_dup:
+  case vld1_lane: {
+    VectorType *VecTy = llvm::dyn_cast<VectorType>(ResultType);
+    Type *EltTy = ResultType->getScalarType();
+    Value *Ptr = Builder.CreateBitCast(Ops[0], EltTy->getPointerTo());
+    Value *Elt =
+        Builder.CreateAlignedLoad(Ptr, EltTy->getPrimitiveSizeInBits() / 8);
+    if (!VecTy)
+      Result = Elt;
+    else if (Handler == vld1_dup)
+      Result = Builder.CreateVectorSplat(VecTy->getNumElements(), Elt);
+    else
+      Result = Builder.CreateInsertElement(Ops[1], Elt, Ops[2]);
+    return true;
+  }
+  case vst1: {
+    Type *VecTy = Ops[1]->getType();
+    Value *Ptr = Builder.CreateBitCast(Ops[0], VecTy->getPointerTo());
+    Builder.CreateAlignedStore(Ops[1], Ptr, VecTy->getScalarSizeInBits() / 8);
+    return true;
+  }
+  case vst1_lane: {
+    Type *EltTy = Ops[1]->getType()->getScalarType();
+    Value *Ptr = Builder.CreateBitCast(Ops[0], EltTy->getPointerTo());
+    Value *Elt = Ops[1]->getType()->isVectorTy() ?
+                 Builder.CreateExtractElement(Ops[1], Ops[2]) : Ops[1];
+    Builder.CreateAlignedStore(Elt, Ptr, EltTy->getPrimitiveSizeInBits() / 8);
+    return true;
+  }
+  case vld2:
+  case vld3:
+  case vld4: {
+    // The vectors are returned packed into one large integer, so the vector
+    // type has to be worked out from the mode in the builtin's name.
+    VectorType *VecTy = GetNeonVectorType(Identifier);
+    if (!VecTy)
+      return false;
+    unsigned NumVecs = Handler == vld2 ? 2 : Handler == vld3 ? 3 : 4;
+    Intrinsic::ID ID = Handler == vld2 ? Intrinsic::arm_neon_vld2 :
+                       Handler == vld3 ? Intrinsic::arm_neon_vld3 :
+                       Intrinsic::arm_neon_vld4;
+    Function *F = Intrinsic::getDeclaration(TheModule, ID, VecTy);
+    Value *Ptr = Builder.CreateBitCast(Ops[0], Builder.getInt8PtrTy());
+    Value *Align = Builder.getInt32(VecTy->getScalarSizeInBits() / 8);
+    Value *Vecs = Builder.CreateCall2(F, Ptr, Align);
+    // Repackage the vectors as the integer GCC expects by going via memory.
+    Value *Tmp = CreateTemporary(ResultType, 16);
+    Value *VecPtr = Builder.CreateBitCast(Tmp, VecTy->getPointerTo());
+    for (unsigned i = 0; i != NumVecs; ++i)
+      Builder.CreateStore(Builder.CreateExtractValue(Vecs, i),
+                          Builder.CreateConstInBoundsGEP1_32(VecPtr, i));
+    Result = Builder.CreateLoad(Tmp);
+    return true;
+  }
+  case vst2:
+  case vst3:
+  case vst4: {
+    VectorType *VecTy = GetNeonVectorType(Identifier);
+    if (!VecTy)
+      return false;
+    unsigned NumVecs = Handler == vst2 ? 2 : Handler == vst3 ? 3 : 4;
+    Intrinsic::ID ID = Handler == vst2 ? Intrinsic::arm_neon_vst2 :
+                       Handler == vst3 ? Intrinsic::arm_neon_vst3 :
+                       Intrinsic::arm_neon_vst4;
+    Function *F = Intrinsic::getDeclaration(TheModule, ID, VecTy);
+    // Unpack the vectors from the integer GCC passes them in.
+    Value *Tmp = CreateTemporary(Ops[1]->getType(), 16);
+    Builder.CreateStore(Ops[1], Tmp);
+    Value *VecPtr = Builder.CreateBitCast(Tmp, VecTy->getPointerTo());
+    SmallVector<Value *, 6> Args;
+    Args.push_back(Builder.CreateBitCast(Ops[0], Builder.getInt8PtrTy()));
+    for (unsigned i = 0; i != NumVecs; ++i)
+      Args.push_back(
+          Builder.CreateLoad(Builder.CreateConstInBoundsGEP1_32(VecPtr, i)));
+    Args.push_back(Builder.getInt32(VecTy->getScalarSizeInBits() / 8));
+    Builder.CreateCall(F, Args);
+    return true;
+  }
+  }
+  llvm_unreachable("Forgot case for code?");
+}
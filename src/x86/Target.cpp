@@ -91,6 +91,28 @@ static Value *BitCastToIntVector(Value *Op, LLVMBuilder &Builder) {
                                VectorType::get(IntTy, VecTy->getNumElements()));
 }
 
+/// CallWithCastedOperands - Call the given intrinsic, first converting each of
+/// the operands to the corresponding parameter type and then converting the
+/// result to ResultType.  GCC sometimes promotes integer arguments to int, and
+/// declares some 128 bit operands with a different vector type to LLVM.
+static Value *CallWithCastedOperands(Intrinsic::ID ID, std::vector<Value *> &Ops,
+                                     Type *ResultType, LLVMBuilder &Builder) {
+  Function *F = Intrinsic::getDeclaration(TheModule, ID);
+  FunctionType *FTy = F->getFunctionType();
+  assert(FTy->getNumParams() == Ops.size() && "Wrong number of operands!");
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i) {
+    Type *ParamTy = FTy->getParamType(i);
+    if (ParamTy->isIntegerTy())
+      Ops[i] = Builder.CreateIntCast(Ops[i], ParamTy, /*isSigned*/ false);
+    else
+      Ops[i] = Builder.CreateBitCast(Ops[i], ParamTy);
+  }
+  Value *Result = Builder.CreateCall(F, Ops);
+  if (ResultType->isIntegerTy())
+    return Builder.CreateIntCast(Result, ResultType, /*isSigned*/ false);
+  return Builder.CreateBitCast(Result, ResultType);
+}
+
 /// BuiltinCode - A enumerated type with one value for each supported builtin.
 enum BuiltinCode {
   SearchForHandler, // Builtin not seen before - search for a handler.
@@ -1076,6 +1098,145 @@ bool TreeToLLVM::TargetIntrinsicLower(
     Result = Builder.CreateExtractValue(Call, 1);
     return true;
   }
+  case crc32qi:
+  case crc32hi:
+  case crc32si:
+  case crc32di: {
+    Intrinsic::ID ID;
+    if (Handler == crc32qi)
+      ID = Intrinsic::x86_sse42_crc32_32_8;
+    else if (Handler == crc32hi)
+      ID = Intrinsic::x86_sse42_crc32_32_16;
+    else if (Handler == crc32si)
+      ID = Intrinsic::x86_sse42_crc32_32_32;
+    else {
+      assert(Handler == crc32di && "Unexpected crc32 builtin!");
+      ID = Intrinsic::x86_sse42_crc32_64_64;
+    }
+    Result = CallWithCastedOperands(ID, Ops, ResultType, Builder);
+    return true;
+  }
+  case aesdec128:
+    Result = CallWithCastedOperands(Intrinsic::x86_aesni_aesdec, Ops,
+                                    ResultType, Builder);
+    return true;
+  case aesdeclast128:
+    Result = CallWithCastedOperands(Intrinsic::x86_aesni_aesdeclast, Ops,
+                                    ResultType, Builder);
+    return true;
+  case aesenc128:
+    Result = CallWithCastedOperands(Intrinsic::x86_aesni_aesenc, Ops,
+                                    ResultType, Builder);
+    return true;
+  case aesenclast128:
+    Result = CallWithCastedOperands(Intrinsic::x86_aesni_aesenclast, Ops,
+                                    ResultType, Builder);
+    return true;
+  case aesimc128:
+    Result = CallWithCastedOperands(Intrinsic::x86_aesni_aesimc, Ops,
+                                    ResultType, Builder);
+    return true;
+  case aeskeygenassist128:
+  case pclmulqdq128:
+  case sha1rnds4:
+  case bextri_u32:
+  case bextri_u64: {
+    // The last operand is encoded in the instruction so must be a constant.
+    if (!isa<ConstantInt>(Ops.back())) {
+      error_at(gimple_location(stmt), "last argument must be an immediate");
+      Result = Ops[0];
+      return true;
+    }
+    Intrinsic::ID ID;
+    if (Handler == aeskeygenassist128)
+      ID = Intrinsic::x86_aesni_aeskeygenassist;
+    else if (Handler == pclmulqdq128)
+      ID = Intrinsic::x86_pclmulqdq;
+    else if (Handler == sha1rnds4)
+      ID = Intrinsic::x86_sha1rnds4;
+    else if (Handler == bextri_u32)
+      ID = Intrinsic::x86_tbm_bextri_u32;
+    else {
+      assert(Handler == bextri_u64 && "Unexpected builtin!");
+      ID = Intrinsic::x86_tbm_bextri_u64;
+    }
+    Result = CallWithCastedOperands(ID, Ops, ResultType, Builder);
+    return true;
+  }
+  case sha1msg1:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha1msg1, Ops, ResultType,
+                                    Builder);
+    return true;
+  case sha1msg2:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha1msg2, Ops, ResultType,
+                                    Builder);
+    return true;
+  case sha1nexte:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha1nexte, Ops, ResultType,
+                                    Builder);
+    return true;
+  case sha256msg1:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha256msg1, Ops, ResultType,
+                                    Builder);
+    return true;
+  case sha256msg2:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha256msg2, Ops, ResultType,
+                                    Builder);
+    return true;
+  case sha256rnds2:
+    Result = CallWithCastedOperands(Intrinsic::x86_sha256rnds2, Ops,
+                                    ResultType, Builder);
+    return true;
+  case bextr_u32:
+  case bextr_u64: {
+    // Extract Len = Ops[1][15:8] bits starting at bit Start = Ops[1][7:0].  If
+    // the control word is a constant, this is just a shift and a mask which
+    // the optimizers understand, otherwise use the BMI intrinsic.
+    if (ConstantInt *Ctl = llvm::dyn_cast<ConstantInt>(Ops[1])) {
+      unsigned BitWidth = ResultType->getPrimitiveSizeInBits();
+      uint64_t Start = Ctl->getZExtValue() & 0xFF;
+      uint64_t Len = (Ctl->getZExtValue() >> 8) & 0xFF;
+      if (Start >= BitWidth || !Len) {
+        Result = Constant::getNullValue(ResultType);
+        return true;
+      }
+      Len = std::min(Len, BitWidth - Start);
+      Result = Builder.CreateIntCast(Ops[0], ResultType, /*isSigned*/ false);
+      Result = Builder.CreateLShr(Result, Start);
+      Result = Builder.CreateAnd(
+          Result, ConstantInt::get(ResultType,
+                                   APInt::getLowBitsSet(BitWidth, Len)));
+      return true;
+    }
+    Intrinsic::ID ID = Handler == bextr_u32 ? Intrinsic::x86_bmi_bextr_32 :
+                       Intrinsic::x86_bmi_bextr_64;
+    Result = CallWithCastedOperands(ID, Ops, ResultType, Builder);
+    return true;
+  }
+  case bzhi_si:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_bzhi_32, Ops,
+                                    ResultType, Builder);
+    return true;
+  case bzhi_di:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_bzhi_64, Ops,
+                                    ResultType, Builder);
+    return true;
+  case pdep_si:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_pdep_32, Ops,
+                                    ResultType, Builder);
+    return true;
+  case pdep_di:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_pdep_64, Ops,
+                                    ResultType, Builder);
+    return true;
+  case pext_si:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_pext_32, Ops,
+                                    ResultType, Builder);
+    return true;
+  case pext_di:
+    Result = CallWithCastedOperands(Intrinsic::x86_bmi_pext_64, Ops,
+                                    ResultType, Builder);
+    return true;
   }
   llvm_unreachable("Forgot case for code?");
 }
@@ -1197,13 +1358,12 @@ static void count_num_registers_uses(std::vector<Type *> &ScalarElts,
   for (size_t i = 0, e = ScalarElts.size(); i != e; ++i) {
     Type *Ty = ScalarElts[i];
     if (VectorType *VTy = llvm::dyn_cast<VectorType>(Ty)) {
-      if (!TARGET_MACHO)
-        continue;
-      if (VTy->getNumElements() == 1)
+      if (TARGET_MACHO && VTy->getNumElements() == 1)
         // v1i64 is passed in GPRs on Darwin.
         ++NumGPRs;
       else
-        // All other vector scalar values are passed in XMM registers.
+        // All other vector scalar values are passed in XMM registers (or in
+        // the YMM/ZMM registers overlapping them).
         ++NumXMMs;
     } else if (Ty->isIntegerTy() || Ty->isPointerTy()) {
       ++NumGPRs;
@@ -1267,6 +1427,24 @@ bool llvm_x86_64_aggregate_partially_passed_in_regs(
   return !GPRsSatisfied || !XMMsSatisfied;
 }
 
+/// llvm_x86_64_sseup_vector_type - Return the LLVM vector type holding the
+/// NumBytes bytes of TreeType that were classified as one SSE eightbyte
+/// followed by SSEUP eightbytes.  With AVX and AVX-512 such a run occupies a
+/// single YMM or ZMM register.
+static Type *llvm_x86_64_sseup_vector_type(tree TreeType, unsigned NumBytes) {
+  Type *Ty = ConvertType(TreeType);
+  if (StructType *STy = llvm::dyn_cast<StructType>(Ty))
+    // Look pass the struct wrapper.
+    if (STy->getNumElements() == 1)
+      Ty = STy->getElementType(0);
+  if (VectorType *VTy = llvm::dyn_cast<VectorType>(Ty))
+    if (VTy->getBitWidth() == NumBytes * 8)
+      return VTy;
+  if (llvm_x86_is_all_integer_types(Ty))
+    return VectorType::get(Type::getInt32Ty(Context), NumBytes / 4);
+  return VectorType::get(Type::getFloatTy(Context), NumBytes / 4);
+}
+
 /* Target hook for llvm-abi.h. It returns true if an aggregate of the
    specified type should be passed in a number of registers of mixed types.
    It also returns a vector of types that correspond to the registers used
@@ -1306,7 +1484,18 @@ bool llvm_x86_64_should_pass_aggregate_in_mixed_regs(
       //                                         <2 x i64>, or <2 x f64>.
       // 4. 1 x SSE + 1 x SSESF, size is 12: 1 x Double, 1 x Float.
       // 5. 2 x SSE, size is 16: 2 x Double.
-      if ((NumClasses - i) == 1) {
+      // 6. 1 x SSE + 3 or 7 x SSEUP, size is 32 or 64: one AVX or AVX-512
+      //    vector.
+      if ((NumClasses - i) > 2 && Class[i + 1] == X86_64_SSEUP_CLASS) {
+        int NumSSEUp = 1;
+        while (i + NumSSEUp + 1 < NumClasses &&
+               Class[i + NumSSEUp + 1] == X86_64_SSEUP_CLASS)
+          ++NumSSEUp;
+        Elts.push_back(
+            llvm_x86_64_sseup_vector_type(TreeType, (NumSSEUp + 1) * 8));
+        Bytes -= (NumSSEUp + 1) * 8;
+        i += NumSSEUp;
+      } else if ((NumClasses - i) == 1) {
         if (Bytes == 8) {
           Elts.push_back(Type::getDoubleTy(Context));
           Bytes -= 8;
@@ -1400,6 +1589,21 @@ bool llvm_x86_64_should_pass_aggregate_in_mixed_regs(
   return !totallyEmpty;
 }
 
+/* llvm_x86_vector_fits_in_register - Return true if a vector of the given
+   size in bits fits in a single XMM, YMM or ZMM register with the enabled
+   instruction set extensions.  */
+static bool llvm_x86_vector_fits_in_register(unsigned HOST_WIDE_INT Bits) {
+  if (Bits <= 128)
+    return TARGET_SSE;
+  if (Bits <= 256)
+    return TARGET_AVX;
+#ifdef TARGET_AVX512F
+  if (Bits <= 512)
+    return TARGET_AVX512F;
+#endif
+  return false;
+}
+
 /* On Darwin x86-32, vectors which are not MMX nor SSE should be passed as
    integers.  On Darwin x86-64, such vectors bigger than 128 bits should be
    passed in memory (byval). */
@@ -1418,17 +1622,18 @@ bool llvm_x86_should_pass_vector_in_integer_regs(tree type) {
   return true;
 }
 
-/* On Darwin x86-64, vectors which are bigger than 128 bits should be passed
-   byval (in memory).  */
+/* On x86-64, vectors which are bigger than 128 bits are passed in a YMM or
+   ZMM register if AVX or AVX-512 is enabled, like GCC does, and byval (in
+   memory) otherwise.  */
 bool llvm_x86_should_pass_vector_using_byval_attr(tree type) {
-  if (!TARGET_MACHO)
-    return false;
   if (!TARGET_64BIT)
     return false;
   if (isa<VECTOR_TYPE>(type) && TYPE_SIZE(type) &&
       isa<INTEGER_CST>(TYPE_SIZE(type))) {
-    if (TREE_INT_CST_LOW(TYPE_SIZE(type)) <= 128)
+    unsigned HOST_WIDE_INT Bits = TREE_INT_CST_LOW(TYPE_SIZE(type));
+    if (Bits <= 128)
       return false;
+    return !llvm_x86_vector_fits_in_register(Bits);
   }
   return true;
 }
@@ -1469,7 +1674,8 @@ tree llvm_x86_should_return_selt_struct_as_scalar(tree type) {
 }
 
 /* MMX vectors v2i32, v4i16, v8i8, v2f32 are returned using sret on Darwin
-   32-bit.  Vectors bigger than 128 are returned using sret.  */
+   32-bit.  Vectors bigger than 128 are returned using sret, unless there is
+   a YMM or ZMM register to hold them.  */
 bool llvm_x86_should_return_vector_as_shadow(tree type, bool isBuiltin) {
   if (TARGET_MACHO && !isBuiltin && !TARGET_64BIT && isa<VECTOR_TYPE>(type) &&
       TYPE_SIZE(type) && isa<INTEGER_CST>(TYPE_SIZE(type))) {
@@ -1477,8 +1683,10 @@ bool llvm_x86_should_return_vector_as_shadow(tree type, bool isBuiltin) {
         TYPE_VECTOR_SUBPARTS(type) > 1)
       return true;
   }
-  if (TREE_INT_CST_LOW(TYPE_SIZE(type)) > 128)
-    return true;
+  // Win64 always returns these in memory.
+  unsigned HOST_WIDE_INT Bits = TREE_INT_CST_LOW(TYPE_SIZE(type));
+  if (Bits > 128)
+    return TARGET_64BIT_MS_ABI || !llvm_x86_vector_fits_in_register(Bits);
   return false;
 }
 
@@ -1654,7 +1862,18 @@ static void llvm_x86_64_get_multiple_return_reg_classes(
       // 4. 1 x SSE + 1 x SSESF, size is 12: 1 x Double, 1 x Float.
       // 5. 2 x SSE, size is 16: 2 x Double.
       // 6. 1 x SSE, 1 x NO:  Second is padding, pass as double.
-      if ((NumClasses - i) == 1) {
+      // 7. 1 x SSE + 3 or 7 x SSEUP, size is 32 or 64: one AVX or AVX-512
+      //    vector.
+      if ((NumClasses - i) > 2 && Class[i + 1] == X86_64_SSEUP_CLASS) {
+        int NumSSEUp = 1;
+        while (i + NumSSEUp + 1 < NumClasses &&
+               Class[i + NumSSEUp + 1] == X86_64_SSEUP_CLASS)
+          ++NumSSEUp;
+        Elts.push_back(
+            llvm_x86_64_sseup_vector_type(TreeType, (NumSSEUp + 1) * 8));
+        Bytes -= (NumSSEUp + 1) * 8;
+        i += NumSSEUp;
+      } else if ((NumClasses - i) == 1) {
         if (Bytes == 8) {
           Elts.push_back(Type::getDoubleTy(Context));
           Bytes -= 8;
@@ -1965,6 +2184,9 @@ void llvm_x86_set_subtarget_features(std::string &C,
   addFeature(F, "3dnowa", TARGET_3DNOW_A);
   addFeature(F, "aes", TARGET_AES);
   addFeature(F, "avx", TARGET_AVX);
+#ifdef TARGET_AVX512F
+  addFeature(F, "avx512f", TARGET_AVX512F);
+#endif
   addFeature(F, "cx16", TARGET_CMPXCHG16B);
   addFeature(F, "fma", TARGET_FMA);
   addFeature(F, "fma4", TARGET_FMA4);
@@ -0,0 +1,19 @@
+// RUN: %dragonegg -std=c++0x -S -o - %s | FileCheck %s
+// XFAIL: gcc-4.5
+// The tail padding of the base class holds the next field.  The initializer
+// keeps the leading elements of the base and has the named type of the record.
+
+class A {
+  int i;
+  char c;
+public:
+  constexpr A(int x, char y) : i(x), c(y) {}
+};
+
+struct B : A {
+  char d;
+  constexpr B() : A(1, 2), d(3) {}
+};
+
+B b;
+// CHECK: @b = global %struct.B { <{ i32, i8 }> <{ i32 1, i8 2 }>, i8 3
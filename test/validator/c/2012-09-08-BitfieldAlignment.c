@@ -1,5 +1,6 @@
 // RUN: %dragonegg -S %s -o - | FileCheck %s
-// Check that bitfields are aligned properly.
+// Check that bitfields are aligned properly.  The calls stop neighbouring
+// stores being merged into one read-modify-write.
 
 struct __attribute__ ((__packed__)) __attribute__ ((aligned (4))) Foo {
     int aligned;
@@ -19,21 +20,27 @@ void bar() {
   foo.aligned4_a = 7;
 // CHECK: load i8* {{.*}}, align 4
 // CHECK: store i8 {{.*}}, align 4
+  baz(&foo);
   foo.aligned4_b = 7;
 // CHECK: load i8* {{.*}}, align 4
 // CHECK: store i8 {{.*}}, align 4
+  baz(&foo);
   foo.aligned4_c = 7;
 // CHECK: load i16* {{.*}}, align 4
 // CHECK: store i16 {{.*}}, align 4
+  baz(&foo);
   foo.aligned1_a = 7;
 // CHECK: load i8* {{.*}}, align 1
 // CHECK: store i8 {{.*}}, align 1
+  baz(&foo);
   foo.aligned1_b = 7;
 // CHECK: load i8* {{.*}}, align 1
 // CHECK: store i8 {{.*}}, align 1
+  baz(&foo);
   foo.aligned1_c = 7;
 // CHECK: load i16* {{.*}}, align 1
 // CHECK: store i16 {{.*}}, align 1
+  baz(&foo);
   foo.aligned2 = 7;
 // CHECK: load i8* {{.*}}, align 2
 // CHECK: store i8 {{.*}}, align 2
@@ -0,0 +1,25 @@
+// RUN: %dragonegg -S %s -o - -mavx | FileCheck %s
+// XFAIL: gcc-4.5, i386, i486, i586, i686
+// Medium sized aggregates are copied and zeroed using wide loads and stores.
+
+struct M {
+  int a[10];
+};
+
+void copy(struct M *d, struct M *s) {
+// CHECK: @copy
+// CHECK: load <32 x i8>
+// CHECK: load i64
+// CHECK-NOT: memcpy
+// CHECK: ret void
+  *d = *s;
+}
+
+void clear(struct M *d) {
+// CHECK: @clear
+// CHECK: store <32 x i8> zeroinitializer
+// CHECK: store i64 0
+// CHECK-NOT: memset
+// CHECK: ret void
+  *d = (struct M){ { 0 } };
+}
@@ -0,0 +1,19 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// XFAIL: i386, i486, i586, i686
+// Signed array indices are sign extended by the getelementptr itself, only
+// unsigned ones need an explicit extension.
+
+int a[100];
+
+int load_signed(int i) {
+// CHECK: @load_signed
+// CHECK-NOT: sext
+// CHECK: getelementptr inbounds i32* {{.*}}, i32 %
+  return a[i];
+}
+
+int load_unsigned(unsigned i) {
+// CHECK: @load_unsigned
+// CHECK: zext i32 {{.*}} to i64
+  return a[i];
+}
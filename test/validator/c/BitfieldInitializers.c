@@ -0,0 +1,8 @@
+// RUN: %dragonegg -S -o - %s | FileCheck %s
+// XFAIL: powerpc, sparc
+// Constant bitfields sharing bytes are packed into a single integer.
+
+struct S { unsigned a : 4, b : 8, c : 4; };
+
+// CHECK: @s = global {{.*}}i16 23231
+struct S s = { 0xf, 0xab, 0x5 };
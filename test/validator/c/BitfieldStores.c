@@ -0,0 +1,66 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// RUN: %dragonegg -S %s -o - -fstrict-volatile-bitfields | FileCheck -check-prefix=VOLATILE %s
+// XFAIL: gcc-4.5
+// Stores to neighbouring bitfields are done with a single read-modify-write.
+
+struct H {
+  unsigned version : 4, ihl : 4, tos : 8;
+  unsigned short len;
+};
+
+void set(struct H *h, unsigned v, unsigned l) {
+// CHECK: @set
+// CHECK: load i16
+// CHECK-NOT: load
+// CHECK: store i16
+// CHECK-NOT: store
+// CHECK: ret void
+  h->version = v;
+  h->ihl = l;
+  h->tos = 0;
+}
+
+struct V {
+  volatile unsigned flag : 1;
+};
+
+void mark(struct V *p) {
+// VOLATILE: @mark
+// VOLATILE: load volatile i32
+// VOLATILE: store volatile i32
+  p->flag = 1;
+}
+
+// The merged read-modify-write keeps the alignment of the bytes it touches.
+struct __attribute__ ((__packed__)) __attribute__ ((aligned (4))) P {
+  int i;
+  unsigned char a : 3, b : 3, c : 3, d : 3, e : 3;
+};
+
+extern void use(struct P *);
+
+void aligned4() {
+// CHECK: @aligned4
+// CHECK: load i8* {{.*}}, align 4
+// CHECK-NOT: load
+// CHECK: store i8 {{.*}}, align 4
+// CHECK-NOT: store
+// CHECK: call void @use
+  struct P p;
+  p.a = 7;
+  p.b = 7;
+  use(&p);
+}
+
+void aligned1() {
+// CHECK: @aligned1
+// CHECK: load i8* {{.*}}, align 1
+// CHECK-NOT: load
+// CHECK: store i8 {{.*}}, align 1
+// CHECK-NOT: store
+// CHECK: call void @use
+  struct P p;
+  p.d = 7;
+  p.e = 7;
+  use(&p);
+}
@@ -0,0 +1,14 @@
+// RUN: %dragonegg -S %s -o - | FileCheck -check-prefix=DEFAULT %s
+// RUN: %dragonegg -S %s -o - -fcx-limited-range | FileCheck -check-prefix=LIMITED %s
+// Complex division scales by the bigger part of the divisor unless the range
+// of the operands is limited.
+
+_Complex double div(_Complex double x, _Complex double y) {
+  return x / y;
+// DEFAULT: call double @llvm.fabs.f64
+// DEFAULT: fcmp oge double
+// DEFAULT: select i1
+// LIMITED-NOT: @llvm.fabs
+// LIMITED: fdiv double 1.000000e+00
+// LIMITED-NOT: fdiv
+}
@@ -0,0 +1,13 @@
+// RUN: %dragonegg -S %s -o - -O1 | FileCheck %s
+// RUN: %dragonegg -S %s -o - -O0 | FileCheck -check-prefix=O0 %s
+// XFAIL: *
+// XTARGET: x86
+// Large arrays are given the target's preferred data alignment when optimizing.
+
+float table[256] = { 1.0f };
+// CHECK: @table = {{.*}}, align {{32|64}}
+// O0: @table
+// O0-NOT: align {{32|64}}
+
+char small[4] = { 1 };
+// CHECK: @small = global [4 x i8] c"\01\00\00\00"{{$}}
@@ -0,0 +1,24 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// XFAIL: gcc-4.5, gcc-4.6
+// Variables in disjoint scopes get lifetime starts as well as ends, allowing
+// their stack slots to be shared.
+
+void use(char *);
+
+void f(int n) {
+  int i;
+  for (i = 0; i < n; ++i) {
+    char a[100];
+    use(a);
+  }
+  {
+    char b[200];
+    use(b);
+  }
+}
+// CHECK: call void @llvm.lifetime.start(i64 100
+// CHECK: call void @use
+// CHECK: call void @llvm.lifetime.end(i64 100
+// CHECK: call void @llvm.lifetime.start(i64 200
+// CHECK: call void @use
+// CHECK: call void @llvm.lifetime.end(i64 200
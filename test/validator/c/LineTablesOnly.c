@@ -0,0 +1,19 @@
+// RUN: %dragonegg -S %s -o - -g1 | FileCheck %s
+// RUN: %dragonegg -S %s -o - -g | FileCheck -check-prefix=FULL %s
+// At -g1 only line tables are output: no variables or types.
+
+struct S { int a, b; };
+struct S s;
+
+int f(struct S *p) {
+  int x = p->a;
+  return x + p->b;
+}
+// CHECK: define {{.*}} @f(
+// CHECK-NOT: llvm.dbg.declare
+// CHECK: !dbg
+// CHECK-NOT: DW_TAG_base_type
+// CHECK-NOT: DW_TAG_structure_type
+// CHECK-NOT: DW_TAG_variable
+// FULL: llvm.dbg.declare
+// FULL: DW_TAG_structure_type
@@ -0,0 +1,19 @@
+// RUN: %dragonegg -S %s -o - -O1 -fplugin-arg-dragonegg-merge-functions | FileCheck %s
+// RUN: %dragonegg -S %s -o - -O1 | FileCheck -check-prefix=TAKEN %s
+// Functions whose address is not taken are unnamed_addr, and identical ones
+// are folded together when asked to.
+
+__attribute__((noinline)) static int f(int x) { return x * 3 + 1; }
+__attribute__((noinline)) static int g(int x) { return x * 3 + 1; }
+
+int (*p)(void);
+int taken(void) { return 0; }
+// TAKEN: define i32 @taken() #
+
+int h(int x) {
+// CHECK: define i32 @h({{.*}}) unnamed_addr
+// CHECK: call i32 @[[FN:[fg]]](
+// CHECK: call i32 @[[FN]](
+  p = taken;
+  return f(x) + g(x);
+}
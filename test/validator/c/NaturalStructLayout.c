@@ -0,0 +1,9 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// Records laid out like LLVM would lay them out get an ordinary struct type,
+// without explicit tail padding.
+
+// CHECK: %struct.S = type { double, i8 }
+struct S { double d; char c; } s;
+
+// CHECK: @t = global %struct.S { double 1.000000e+00, i8 2 }
+struct S t = { 1.0, 2 };
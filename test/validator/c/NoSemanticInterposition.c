@@ -0,0 +1,28 @@
+// RUN: %dragonegg -S %s -o - -fPIC -fplugin-arg-dragonegg-no-semantic-interposition -fplugin-arg-dragonegg-no-plt | FileCheck %s
+// RUN: %dragonegg -S %s -o - -O2 -fPIC -fplugin-arg-dragonegg-no-semantic-interposition | FileCheck -check-prefix=OPT %s
+// XFAIL: darwin
+// Calls to functions defined in the unit use a local alias, while functions
+// defined elsewhere are not lazily bound.
+
+int ext(int);
+
+__attribute__((noinline)) int f(int x) {
+  return x + 1;
+}
+
+int (*p)(int) = f;
+// CHECK: @p = global i32 (i32)* @f
+
+// CHECK: @f.localalias = {{.*}}alias {{.*}}@f
+
+int g(int x) {
+// CHECK: @g
+// CHECK: call i32 @f.localalias(
+// CHECK: call i32 @ext(
+// OPT: @g
+// OPT: call i32 @f.localalias(
+  return f(x) + ext(x);
+}
+
+// CHECK: declare i32 @ext(i32) #[[ATTR:[0-9]+]]
+// CHECK: attributes #[[ATTR]] = { {{.*}}nonlazybind
@@ -0,0 +1,23 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// XFAIL: *
+// XTARGET: x86_64
+// Whether a struct is returned in memory depends on the ABI of the callee, not
+// on that of the function in which the callee's type happens to be converted.
+
+struct S { int a, b, c; };
+
+struct S sv(void);
+__attribute__((ms_abi)) struct S ms(void);
+
+int use(void) {
+// CHECK: @use
+// CHECK: call void @ms(%struct.S* {{.*}}sret
+// CHECK: call { i64, i32 } @sv()
+  return ms().a + sv().b;
+}
+
+__attribute__((ms_abi)) struct S ms(void) {
+// CHECK: define void @ms(%struct.S* noalias sret
+  struct S s = { 1, 2, 3 };
+  return s;
+}
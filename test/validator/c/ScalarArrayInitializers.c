@@ -0,0 +1,17 @@
+// RUN: %dragonegg -S -o - %s | FileCheck %s
+// Tables of numbers and strings are output directly as constant data.
+
+// CHECK: @ints = global [6 x i32] [i32 1, i32 -2, i32 3, i32 0, i32 7, i32 7]
+int ints[6] = { 1, -2, 3, [4 ... 5] = 7 };
+
+// CHECK: @doubles = global [3 x double] [double 5.000000e-01, double 0.000000e+00, double -2.500000e-01]
+double doubles[3] = { 0.5, [2] = -0.25 };
+
+// CHECK: @shorts = global [3 x i16] [i16 -1, i16 2, i16 0]
+unsigned short shorts[3] = { 0xffff, 2 };
+
+// CHECK: @str = global [5 x i8] c"ab\00\00\00"
+char str[5] = "ab";
+
+// CHECK: @trunc = global [2 x i8] c"fo"
+char trunc[2] = "foo";
@@ -0,0 +1,11 @@
+// RUN: %dragonegg -S -o - %s | FileCheck %s
+// Big arrays with few distinct runs of initial values are built run by run.
+
+// CHECK: @sparse = global { [5 x i32], i32, [89994 x i32], i32, [9999 x i32] } { [5 x i32] zeroinitializer, i32 1, [89994 x i32] zeroinitializer, i32 2, [9999 x i32] zeroinitializer }
+int sparse[100000] = { [5] = 1, [90000] = 2 };
+
+// CHECK: @splat = global { [1953 x [512 x i32]], [64 x i32] }
+int splat[1000000] = { [0 ... 999999] = 7 };
+
+// CHECK: @mixed = global { [1000 x i8], [40 x i8], i8, [1007 x i8] } { [1000 x i8] zeroinitializer, [40 x i8] c"{{(\\01)+}}", i8 2, [1007 x i8] zeroinitializer }
+char mixed[2048] = { [1000 ... 1039] = 1, 2 };
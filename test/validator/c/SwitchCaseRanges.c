@@ -0,0 +1,23 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// Wide case ranges are dispatched with a binary decision tree, starting from
+// the middle range, rather than tested one after the other.
+
+int classify(int c) {
+  switch (c) {
+  case 5: return 9;
+  case 1000 ... 1999: return 1;
+  case 2000 ... 2999: return 2;
+  case 3000 ... 3999: return 3;
+  case 4000 ... 4999: return 4;
+  case 5000 ... 5999: return 5;
+  case 6000 ... 6999: return 6;
+  case 7000 ... 7999: return 7;
+  case 8000 ... 8999: return 8;
+  }
+  return 0;
+}
+// CHECK: switch i32
+// CHECK-NOT: , 1000
+// CHECK: sub i32 %{{.*}}, 5000
+// CHECK: icmp ule i32 %{{.*}}, 999
+// CHECK: icmp slt i32 %{{.*}}, 5000
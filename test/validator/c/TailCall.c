@@ -0,0 +1,9 @@
+// RUN: %dragonegg -S %s -o - -O1 -foptimize-sibling-calls -fplugin-arg-dragonegg-enable-gcc-optzns | FileCheck %s
+// Calls that GCC marked as tail calls are output as tail calls.
+
+int g(int);
+
+int f(int x) {
+// CHECK: tail call i32 @g
+  return g(x + 1);
+}
@@ -0,0 +1,12 @@
+// RUN: %dragonegg -S %s -o - -O1 -fplugin-arg-dragonegg-enable-gcc-optzns | FileCheck %s
+// XFAIL: gcc-4.5
+// Reading vector elements does not go through memory.
+
+typedef int v4si __attribute__((vector_size(16)));
+
+int lane(v4si v) {
+// CHECK: @lane
+// CHECK-NOT: alloca
+// CHECK: extractelement <4 x i32> %{{[^,]*}}, i32 2
+  return v[2];
+}
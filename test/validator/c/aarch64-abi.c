@@ -0,0 +1,72 @@
+// RUN: %dragonegg -S %s -o - | FileCheck %s
+// XFAIL: *
+// XTARGET: aarch64
+
+struct hfa { float x, y, z; };
+struct hva { __attribute__((vector_size(16))) float a, b; };
+struct small { int a, b, c; };
+struct big { long a, b, c; };
+
+float pass_hfa(struct hfa h) {
+// CHECK: define float @pass_hfa(float {{.*}}, float {{.*}}, float
+  return h.z;
+}
+
+struct hfa ret_hfa(float f) {
+// CHECK: define { float, float, float } @ret_hfa(float
+  struct hfa h = { f, f, f };
+  return h;
+}
+
+int pass_hva(struct hva v) {
+// CHECK: define i32 @pass_hva(<4 x float> {{.*}}, <4 x float>
+  return v.b[1];
+}
+
+int pass_small(struct small s) {
+// CHECK: define i32 @pass_small(i64 {{.*}}, i64
+  return s.c;
+}
+
+long pass_big(struct big b) {
+// CHECK: define i64 @pass_big(%struct.big*
+  return b.c;
+}
+
+long call_big(struct big *p) {
+// CHECK: @call_big
+// CHECK: alloca %struct.big
+// CHECK: call i64 @pass_big(%struct.big*
+  return pass_big(*p);
+}
+
+struct big ret_big(long l) {
+// CHECK: define void @ret_big(%struct.big* noalias sret
+  struct big b = { l, l, l };
+  return b;
+}
+
+// A composite that no longer fits in the argument registers goes on the stack,
+// and so do all later arguments of the same register class.
+struct two { long x, y; };
+struct h4 { double a, b, c, d; };
+
+long spill_gpr(long a0, long a1, long a2, long a3, long a4, long a5, long a6,
+               struct two s, long t, double d) {
+// CHECK: define i64 @spill_gpr(
+// CHECK: %struct.two* byval{{[^,]*}}, i64{{[^,]*}}, i64 %t, double %d)
+  return s.y + t + (long)d;
+}
+
+long call_spill_gpr(struct two *p) {
+// CHECK: @call_spill_gpr
+// CHECK: call i64 @spill_gpr({{.*}}%struct.two* byval {{[^,]*}}, i64 undef, i64 7, double
+  return spill_gpr(0, 1, 2, 3, 4, 5, 6, *p, 7, 8.0);
+}
+
+double spill_hfa(double d0, double d1, double d2, double d3, double d4,
+                 struct h4 h, double e, long t) {
+// CHECK: define double @spill_hfa(
+// CHECK: %struct.h4* byval{{[^,]*}}, double{{[^,]*}}, double{{[^,]*}}, double{{[^,]*}}, double %e, i64 %t)
+  return h.d + e + t;
+}
@@ -0,0 +1,39 @@
+// RUN: %dragonegg -S %s -o - -maes -mpclmul | FileCheck %s
+
+#include <wmmintrin.h>
+
+__m128i enc(__m128i s, __m128i k) {
+  return _mm_aesenc_si128(s, k);
+// CHECK: @enc
+// CHECK: call <2 x i64> @llvm.x86.aesni.aesenc
+}
+
+__m128i enclast(__m128i s, __m128i k) {
+  return _mm_aesenclast_si128(s, k);
+// CHECK: @enclast
+// CHECK: call <2 x i64> @llvm.x86.aesni.aesenclast
+}
+
+__m128i dec(__m128i s, __m128i k) {
+  return _mm_aesdec_si128(s, k);
+// CHECK: @dec
+// CHECK: call <2 x i64> @llvm.x86.aesni.aesdec
+}
+
+__m128i imc(__m128i k) {
+  return _mm_aesimc_si128(k);
+// CHECK: @imc
+// CHECK: call <2 x i64> @llvm.x86.aesni.aesimc
+}
+
+__m128i keygen(__m128i k) {
+  return _mm_aeskeygenassist_si128(k, 1);
+// CHECK: @keygen
+// CHECK: call <2 x i64> @llvm.x86.aesni.aeskeygenassist(<2 x i64> {{.*}}, i8 1)
+}
+
+__m128i clmul(__m128i a, __m128i b) {
+  return _mm_clmulepi64_si128(a, b, 0x11);
+// CHECK: @clmul
+// CHECK: call <2 x i64> @llvm.x86.pclmulqdq(<2 x i64> {{.*}}, <2 x i64> {{.*}}, i8 17)
+}
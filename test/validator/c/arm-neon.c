@@ -0,0 +1,95 @@
+// RUN: %dragonegg -S %s -o - -mfpu=neon -mfloat-abi=softfp | FileCheck %s
+// XFAIL: *
+// XTARGET: arm
+
+#include <arm_neon.h>
+
+int8x8_t add(int8x8_t a, int8x8_t b) {
+  return vadd_s8(a, b);
+// CHECK: @add
+// CHECK-NOT: call
+// CHECK: add <8 x i8>
+}
+
+float32x4_t mla(float32x4_t a, float32x4_t b, float32x4_t c) {
+  return vmlaq_f32(a, b, c);
+// CHECK: @mla
+// CHECK: fmul <4 x float>
+// CHECK: fadd <4 x float>
+}
+
+uint16x4_t shr(uint16x4_t a) {
+  return vshr_n_u16(a, 3);
+// CHECK: @shr
+// CHECK: lshr <4 x i16> {{.*}}, <i16 3, i16 3, i16 3, i16 3>
+}
+
+uint8x16_t load(const uint8_t *p) {
+  return vld1q_u8(p);
+// CHECK: @load
+// CHECK: load <16 x i8>* {{.*}}, align 1
+}
+
+void store(int32_t *p, int32x2_t v) {
+  vst1_s32(p, v);
+// CHECK: @store
+// CHECK: store <2 x i32> {{.*}}, align 4
+}
+
+uint8x8x2_t load2(const uint8_t *p) {
+  return vld2_u8(p);
+// CHECK: @load2
+// CHECK: call { <8 x i8>, <8 x i8> } @llvm.arm.neon.vld2.v8i8
+}
+
+void store3(int16_t *p, int16x4x3_t v) {
+  vst3_s16(p, v);
+// CHECK: @store3
+// CHECK: call void @llvm.arm.neon.vst3.v4i16
+}
+
+int16x8_t combine(int16x4_t a, int16x4_t b) {
+  return vcombine_s16(a, b);
+// CHECK: @combine
+// CHECK: shufflevector <4 x i16>
+}
+
+uint16x4_t shr_full(uint16x4_t a) {
+  return vshr_n_u16(a, 16);
+// CHECK: @shr_full
+// CHECK-NOT: lshr
+// CHECK: ret <4 x i16> zeroinitializer
+}
+
+int32x4_t sshr_full(int32x4_t a) {
+  return vshrq_n_s32(a, 32);
+// CHECK: @sshr_full
+// CHECK: ashr <4 x i32> {{.*}}, <i32 31, i32 31, i32 31, i32 31>
+}
+
+int64x2_t combine64(int64x1_t a, int64x1_t b) {
+  return vcombine_s64(a, b);
+// CHECK: @combine64
+// CHECK: insertelement <2 x i64> undef, i64 {{.*}}, i32 0
+// CHECK: insertelement <2 x i64> {{.*}}, i64 {{.*}}, i32 1
+}
+
+int64_t get_lane64(int64x1_t a) {
+  return vget_lane_s64(a, 0);
+// CHECK: @get_lane64
+// CHECK-NOT: extractelement
+// CHECK: ret i64
+}
+
+int64x1_t dup64(int64_t a) {
+  return vdup_n_s64(a);
+// CHECK: @dup64
+// CHECK-NOT: insertelement
+// CHECK: ret i64
+}
+
+int64x1_t high64(int64x2_t a) {
+  return vget_high_s64(a);
+// CHECK: @high64
+// CHECK: extractelement <2 x i64> {{.*}}, i32 1
+}
@@ -0,0 +1,29 @@
+// RUN: %dragonegg -S %s -o - -mavx | FileCheck %s
+// XFAIL: gcc-4.5, i386, i486, i586, i686
+
+typedef float v8sf __attribute__((vector_size(32)));
+typedef double v4df __attribute__((vector_size(32)));
+struct wrapped { v8sf v; };
+
+v8sf add(v8sf a, v8sf b) {
+// CHECK: define <8 x float> @add(<8 x float> %a, <8 x float> %b)
+  return a + b;
+}
+
+v4df scale(v4df a, double s) {
+// CHECK: define <4 x double> @scale(<4 x double> %a, double %s)
+  v4df t = { s, s, s, s };
+  return a * t;
+}
+
+float first(struct wrapped w) {
+// CHECK: define float @first(<8 x float>
+  return w.v[0];
+}
+
+v8sf call_add(v8sf a) {
+// CHECK: @call_add
+// CHECK-NOT: alloca
+// CHECK: call <8 x float> @add(<8 x float> %a, <8 x float> %a)
+  return add(a, a);
+}
@@ -0,0 +1,43 @@
+// RUN: %dragonegg -S %s -o - -mbmi -mbmi2 | FileCheck %s
+// XFAIL: gcc-4.5, gcc-4.6
+
+#include <x86intrin.h>
+
+unsigned bextr_const(unsigned x) {
+  return __bextr_u32(x, 0x0804);
+// CHECK: @bextr_const
+// CHECK: lshr i32 {{.*}}, 4
+// CHECK: and i32 {{.*}}, 255
+}
+
+unsigned bextr_var(unsigned x, unsigned c) {
+  return __bextr_u32(x, c);
+// CHECK: @bextr_var
+// CHECK: call i32 @llvm.x86.bmi.bextr.32
+}
+
+unsigned bzhi(unsigned x, unsigned n) {
+  return _bzhi_u32(x, n);
+// CHECK: @bzhi
+// CHECK: call i32 @llvm.x86.bmi.bzhi.32
+}
+
+unsigned pdep(unsigned x, unsigned m) {
+  return _pdep_u32(x, m);
+// CHECK: @pdep
+// CHECK: call i32 @llvm.x86.bmi.pdep.32
+}
+
+unsigned pext(unsigned x, unsigned m) {
+  return _pext_u32(x, m);
+// CHECK: @pext
+// CHECK: call i32 @llvm.x86.bmi.pext.32
+}
+
+unsigned andn(unsigned x, unsigned y) {
+  return __andn_u32(x, y);
+// CHECK: @andn
+// CHECK-NOT: call
+// CHECK: xor i32
+// CHECK: and i32
+}
@@ -0,0 +1,28 @@
+// RUN: %dragonegg -S %s -o - -msse4.2 | FileCheck %s
+// XFAIL: i386, i486, i586, i686
+
+#include <smmintrin.h>
+
+unsigned crc8(unsigned c, unsigned char v) {
+  return _mm_crc32_u8(c, v);
+// CHECK: @crc8
+// CHECK: call i32 @llvm.x86.sse42.crc32.32.8
+}
+
+unsigned crc16(unsigned c, unsigned short v) {
+  return _mm_crc32_u16(c, v);
+// CHECK: @crc16
+// CHECK: call i32 @llvm.x86.sse42.crc32.32.16
+}
+
+unsigned crc32(unsigned c, unsigned v) {
+  return _mm_crc32_u32(c, v);
+// CHECK: @crc32
+// CHECK: call i32 @llvm.x86.sse42.crc32.32.32
+}
+
+unsigned long long crc64(unsigned long long c, unsigned long long v) {
+  return _mm_crc32_u64(c, v);
+// CHECK: @crc64
+// CHECK: call i64 @llvm.x86.sse42.crc32.64.64
+}
@@ -0,0 +1,134 @@
+//===-- IntervalListBenchmark.cpp - Timing of the disjoint interval lists --===//
+//
+// Copyright (C) 2013  Duncan Sands.
+//
+// This file is part of DragonEgg.
+//
+// DragonEgg is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 2, or (at your option) any later version.
+//
+// DragonEgg is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// DragonEgg; see the file COPYING.  If not, write to the Free Software
+// Foundation, 51 Franklin Street, Suite 500, Boston, MA 02110-1335, USA.
+//
+//===----------------------------------------------------------------------===//
+// Micro-benchmark comparing the ways of building a collection of disjoint
+// intervals: IntervalList::AddInterval, IntervalList::AddIntervals and
+// IntervalTree::AddInterval.  The intervals mimic the fields of a large struct,
+// added in order, in reverse order (as record layout does) and shuffled, with
+// an occasional overlapping "union" field thrown in.
+//
+// Usage: IntervalListBenchmark [number of intervals]
+//===----------------------------------------------------------------------===//
+
+#include "dragonegg/ADT/IntervalList.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <stdint.h>
+
+/// Field - A minimal interval type, like the TypedRange used for record layout.
+class Field {
+  Range<uint64_t> R;
+  unsigned Id;
+
+public:
+  Field(uint64_t First, uint64_t Last, unsigned id) : R(First, Last), Id(id) {}
+
+  Range<uint64_t> getRange() const { return R; }
+  void ChangeRangeTo(Range<uint64_t> r) { R = r; }
+  void JoinWith(const Field &S) { R = R.Join(S.R); }
+  unsigned getId() const { return Id; }
+};
+
+typedef llvm::SmallVector<Field, 8> FieldVector;
+
+/// MakeFields - Lay out NumFields fields of varying sizes one after the other.
+/// Every hundredth field is a union member overlapping its neighbours.
+static void MakeFields(unsigned NumFields, FieldVector &Fields) {
+  uint64_t Offset = 0;
+  for (unsigned i = 0; i != NumFields; ++i) {
+    uint64_t Width = 8 << (i % 4);
+    if (i % 100 == 99 && Offset >= 64)
+      Fields.push_back(Field(Offset - 64, Offset + 64, i));
+    else
+      Fields.push_back(Field(Offset, Offset + Width, i));
+    Offset += Width;
+  }
+}
+
+/// Checksum - Summarize the resulting intervals so the different ways of
+/// building them can be checked against each other.
+static uint64_t Checksum(const FieldVector &Fields) {
+  uint64_t Sum = Fields.size();
+  for (unsigned i = 0, e = Fields.size(); i != e; ++i)
+    Sum = Sum * 31 + Fields[i].getRange().getFirst() * 7 +
+          Fields[i].getRange().getLast() * 3 + Fields[i].getId();
+  return Sum;
+}
+
+static double Seconds(clock_t Start) {
+  return double(clock() - Start) / CLOCKS_PER_SEC;
+}
+
+static void Run(const char *Order, const FieldVector &Fields) {
+  FieldVector Result;
+
+  clock_t Start = clock();
+  IntervalList<Field, uint64_t, 8> One;
+  for (unsigned i = 0, e = Fields.size(); i != e; ++i)
+    One.AddInterval(Fields[i]);
+  double OneTime = Seconds(Start);
+  for (unsigned i = 0, e = One.getNumIntervals(); i != e; ++i)
+    Result.push_back(One.getInterval(i));
+  uint64_t OneSum = Checksum(Result);
+
+  Start = clock();
+  IntervalList<Field, uint64_t, 8> Bulk;
+  Bulk.AddIntervals(Fields.begin(), Fields.end());
+  double BulkTime = Seconds(Start);
+  Result.clear();
+  for (unsigned i = 0, e = Bulk.getNumIntervals(); i != e; ++i)
+    Result.push_back(Bulk.getInterval(i));
+  uint64_t BulkSum = Checksum(Result);
+
+  Start = clock();
+  IntervalTree<Field, uint64_t> Tree;
+  for (unsigned i = 0, e = Fields.size(); i != e; ++i)
+    Tree.AddInterval(Fields[i]);
+  double TreeTime = Seconds(Start);
+  Result.clear();
+  Tree.getIntervals(Result);
+  uint64_t TreeSum = Checksum(Result);
+
+  std::cout << Order << ": AddInterval " << OneTime << "s, AddIntervals "
+            << BulkTime << "s, IntervalTree " << TreeTime << "s";
+  if (OneSum != BulkSum || OneSum != TreeSum)
+    std::cout << " (MISMATCH)";
+  std::cout << "\n";
+}
+
+int main(int argc, char **argv) {
+  unsigned NumFields = argc > 1 ? atoi(argv[1]) : 100000;
+
+  FieldVector Fields;
+  MakeFields(NumFields, Fields);
+  Run("in order", Fields);
+
+  FieldVector Reversed(Fields.rbegin(), Fields.rend());
+  Run("reversed", Reversed);
+
+  FieldVector Shuffled(Fields);
+  srand(0);
+  for (unsigned i = Shuffled.size(); i > 1; --i)
+    std::swap(Shuffled[i - 1], Shuffled[rand() % i]);
+  Run("shuffled", Shuffled);
+
+  return 0;
+}